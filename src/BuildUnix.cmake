@@ -8,9 +8,14 @@
 
 message (STATUS "Building Linux version")
 
-# Static where possible (i.e. only not on the APPLE)
-set (CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -static -m32")
-
 set (scythername "scyther-linux")
 add_executable (${scythername} ${Scyther_sources})
 
+# The executable is 32-bit, and static where possible (i.e. only not on the
+# APPLE). Both only apply to the executable: the shared library cannot be
+# linked statically, and is built for the word size of the host, so that a
+# host program can load it.
+set_target_properties (${scythername} PROPERTIES
+	COMPILE_FLAGS "-m32"
+	LINK_FLAGS "-static -m32")
+
@@ -60,6 +60,10 @@
 #include "xmlout.h"
 #include "heuristic.h"
 #include "tempfile.h"
+#include "jobs.h"
+#include "slab.h"
+#include "symmetry.h"
+#include "statecache.h"
 
 extern int *graph;
 extern int nodes;
@@ -82,12 +86,19 @@ static int indentDepth;
 static int prevIndentDepth;
 static int indentDepthChanges;
 static FILE *attack_stream;
+#ifdef DEBUG
+static int sendIndexChecks;	//!< Send candidates checked by the send index
+static int sendIndexRejects;	//!< Send candidates rejected by the send index
+#endif
 
 /*
  * Forward declarations
  */
 
 int iterate ();
+int iterate_alternative (int (*alternative) (void));
+void sendIndexBuild (void);
+static void knowpointsClear (void);
 
 /*
  * Program code
@@ -156,6 +167,7 @@ arachneInit (const System mysys)
   prevIndentDepth = 0;
   indentDepthChanges = 0;
 
+  sendIndexBuild ();
   return;
 }
 
@@ -163,7 +175,56 @@ arachneInit (const System mysys)
 void
 arachneDone ()
 {
-  return;
+#ifdef DEBUG
+  if (DEBUGL (1))
+    {
+      eprintf ("Send index rejected %i of %i send candidates.\n",
+	       sendIndexRejects, sendIndexChecks);
+    }
+#endif
+  mguDone ();
+  knowpointsClear ();
+  stateCacheDone ();
+  symmetryDone ();
+  hidelevelDone ();
+}
+
+//! Store the state of the Arachne engine in a verifier context
+void
+arachneContextSave (const VerifierContext ctx)
+{
+  ctx->sys = sys;
+  ctx->intruder = INTRUDER;
+  ctx->intruderM = I_M;
+  ctx->intruderRRS = I_RRS;
+  ctx->intruderRRSD = I_RRSD;
+  ctx->attackLength = attack_length;
+  ctx->attackLeastcost = attack_leastcost;
+  ctx->proofDepth = proofDepth;
+  ctx->maxEncryptionLevel = max_encryption_level;
+  ctx->indentDepth = indentDepth;
+  ctx->prevIndentDepth = prevIndentDepth;
+  ctx->indentDepthChanges = indentDepthChanges;
+  ctx->attackStream = attack_stream;
+}
+
+//! Restore the state of the Arachne engine from a verifier context
+void
+arachneContextLoad (const VerifierContext ctx)
+{
+  sys = ctx->sys;
+  INTRUDER = ctx->intruder;
+  I_M = ctx->intruderM;
+  I_RRS = ctx->intruderRRS;
+  I_RRSD = ctx->intruderRRSD;
+  attack_length = ctx->attackLength;
+  attack_leastcost = ctx->attackLeastcost;
+  proofDepth = ctx->proofDepth;
+  max_encryption_level = ctx->maxEncryptionLevel;
+  indentDepth = ctx->indentDepth;
+  prevIndentDepth = ctx->prevIndentDepth;
+  indentDepthChanges = ctx->indentDepthChanges;
+  attack_stream = ctx->attackStream;
 }
 
 //------------------------------------------------------------------------
@@ -660,6 +721,308 @@ iterate_role_sends (int (*func) ())
   return iterate_role_events (send_wrapper);
 }
 
+//! Entry of the index of role send events
+/**
+ * Regular goals can only be bound to send events whose message has a
+ * subterm that unifies with the goal. The entry summarizes the subterms
+ * that subtermUnify() would try, so that most hopeless candidates are
+ * rejected without unification.
+ */
+struct sendentry
+{
+  Protocol protocol;		//!< Protocol of the send
+  Role role;			//!< Role of the send
+  Roledef rd;			//!< The send event
+  int index;			//!< Index of the event in the role
+  int anyshape;			//!< True if a subterm is a role variable that can be anything
+  int firstshape;		//!< First shape in sys->sendshapes
+  int shapecount;		//!< Number of shapes
+  int firstposition;		//!< First subterm position in sys->sendpositions
+  int positioncount;		//!< Number of subterm positions
+};
+
+//! Shape of a subterm of a send message
+struct sendshape
+{
+  int type;			//!< LEAF, ENCRYPT, TUPLE, or VARIABLE for a typed role variable
+  //! Leaf symbol, or the symbol that fingerprints the encryption key
+  /**
+   * For an encryption, this is the symbol of a constant key, or the
+   * function symbol of a key such as pk(R). NULL if the key can be
+   * anything.
+   */
+  Symbol symb;
+  int keytype;			//!< LEAF or ENCRYPT: the shape of a fingerprinted key
+  Termlist stype;		//!< Types of a role variable
+};
+
+//! Build the index of role send events, in the order of iterate_role_sends()
+/**
+ * The subterms are those tried by subtermUnify(): the message itself and,
+ * if there is an intruder, the components of tuples and the contents of
+ * encryptions.
+ *
+ * The role-local terms are variables to Arachne by now, but the constants
+ * of a role become constants of each run with the same symbol. A goal can
+ * therefore only come from such a constant if it has that symbol, and they
+ * are indexed as leaves. Only the other role-local terms are open, and
+ * unless they are of the ticket type or matching is untyped, they can only
+ * be instantiated with leaves (cf. checkTypeTerm()).
+ */
+void
+sendIndexBuild (void)
+{
+  int maxsends;
+  int maxshapes;
+  int shapes;
+  int maxpositions;
+  int positions;
+
+  // A variable of the role, as opposed to a constant of the role
+  int is_open (const struct sendentry *e, const Term t)
+  {
+    return (realTermVariable (t) && !inTermlist (e->role->declaredconsts, t));
+  }
+
+  // The shapes are those of the subterm positions of the send, so that
+  // only subtermPositions() follows the traversal of subtermUnify()
+  void add_shapes (struct sendentry *e)
+  {
+    const struct subtermpos *pos;
+    Term *terms;
+    int i;
+
+    pos = sys->sendpositions + e->firstposition;
+    terms = (Term *) malloc (e->positioncount * sizeof (Term));
+    if (e->positioncount > 0 && terms == NULL)
+      {
+	error ("Out of memory for the send index.");
+      }
+    e->anyshape = false;
+    e->firstshape = shapes;
+    for (i = 0; i < e->positioncount; i++)
+      {
+	struct sendshape *s;
+	Term t;
+
+	t = subtermAtPosition (e->rd->message, &(pos[i]), terms);
+	terms[i] = t;
+	if (pos[i].open && is_open (e, t)
+	    && (switches.match >= 2 || isOpenVariable (t)))
+	  {
+	    e->anyshape = true;
+	    continue;
+	  }
+	if (shapes >= maxshapes)
+	  {
+	    maxshapes = 2 * maxshapes;
+	    sys->sendshapes = (struct sendshape *)
+	      realloc (sys->sendshapes, maxshapes * sizeof (struct sendshape));
+	    if (sys->sendshapes == NULL)
+	      {
+		error ("Out of memory for the send index.");
+	      }
+	  }
+	s = &(sys->sendshapes[shapes]);
+	s->symb = NULL;
+	s->stype = NULL;
+	if (pos[i].open && is_open (e, t))
+	  {
+	    s->type = VARIABLE;
+	    s->stype = t->stype;
+	  }
+	else if (realTermLeaf (t))
+	  {
+	    s->type = LEAF;
+	    s->symb = TermSymb (t);
+	  }
+	else if (realTermEncrypt (t))
+	  {
+	    Term key;
+
+	    s->type = ENCRYPT;
+	    key = deVar (TermKey (t));
+	    if (realTermLeaf (key) && !is_open (e, key))
+	      {
+		s->symb = TermSymb (key);
+		s->keytype = LEAF;
+	      }
+	    else if (realTermEncrypt (key))
+	      {
+		Term f;
+
+		// Function application such as pk(R) or k(I,R)
+		f = deVar (TermKey (key));
+		if (realTermLeaf (f) && !is_open (e, f))
+		  {
+		    s->symb = TermSymb (f);
+		    s->keytype = ENCRYPT;
+		  }
+	      }
+	  }
+	else
+	  {
+	    s->type = TUPLE;
+	  }
+	shapes++;
+      }
+    free (terms);
+    e->shapecount = shapes - e->firstshape;
+  }
+
+  int count_send (Protocol p, Role r, Roledef rd, int index)
+  {
+    maxsends++;
+    return true;
+  }
+
+  int add_send (Protocol p, Role r, Roledef rd, int index)
+  {
+    struct sendentry *e;
+
+    if (p == INTRUDER)
+      {
+	return true;
+      }
+    e = &(sys->sends[sys->sendcount]);
+    e->protocol = p;
+    e->role = r;
+    e->rd = rd;
+    e->index = index;
+    e->firstposition = positions;
+    positions = subtermPositions (rd->message, &(sys->sendpositions),
+				  &maxpositions, positions);
+    e->positioncount = positions - e->firstposition;
+    add_shapes (e);
+    // Runs copy the role events, and with them the entry
+    rd->sendentry = sys->sendcount;
+    sys->sendcount++;
+    return true;
+  }
+
+  free (sys->sends);
+  free (sys->sendshapes);
+  free (sys->sendpositions);
+  sys->sendpositions = NULL;
+  maxpositions = 0;
+  positions = 0;
+  maxsends = 0;
+  iterate_role_sends (count_send);
+  sys->sends = (struct sendentry *) malloc ((maxsends + 1) *
+					     sizeof (struct sendentry));
+  maxshapes = 64;
+  sys->sendshapes = (struct sendshape *) malloc (maxshapes *
+						 sizeof (struct sendshape));
+  if (sys->sends == NULL || sys->sendshapes == NULL)
+    {
+      error ("Out of memory for the send index.");
+    }
+  sys->sendcount = 0;
+  shapes = 0;
+  iterate_role_sends (add_send);
+}
+
+//! Find the index entry of a send event of a role or a run
+/**
+ *@return The entry, or NULL if the event is not in the index.
+ */
+struct sendentry *
+sendIndexFind (const Roledef rd)
+{
+  if (rd->sendentry < 0)
+    {
+      return NULL;
+    }
+  return &(sys->sends[rd->sendentry]);
+}
+
+//! Subterm unification of a goal with an indexed send
+/**
+ * Uses the precomputed subterm positions of the send. The big term must be
+ * the send message itself or an instance of it in a run.
+ */
+int
+sendIndexUnify (const struct sendentry *e, Term tbig, Term tsmall,
+		int (*callback) (Termlist, Termlist))
+{
+  return subtermUnifyPositions (tbig, sys->sendpositions + e->firstposition,
+				e->positioncount, tsmall, NULL, callback);
+}
+
+//! Check whether a goal term might unify with a subterm of an indexed send
+/**
+ * A false result guarantees that the goal cannot be bound to the send in
+ * any run; a true result is only a candidate.
+ */
+int
+sendIndexMatch (const struct sendentry *e, Term t)
+{
+  int i;
+
+  if (e->anyshape)
+    return true;
+  t = deVar (t);
+  if (realTermVariable (t))
+    return true;
+  for (i = e->firstshape; i < e->firstshape + e->shapecount; i++)
+    {
+      const struct sendshape *s;
+
+      s = &(sys->sendshapes[i]);
+      if (realTermLeaf (t))
+	{
+	  if (s->type == LEAF && s->symb == TermSymb (t))
+	    return true;
+	  if (s->type == VARIABLE)
+	    {
+	      Termlist tl;
+
+	      // With strict typing, one of the types must match
+	      if (switches.match != 0)
+		return true;
+	      for (tl = s->stype; tl != NULL; tl = tl->next)
+		{
+		  if (inTermlist (t->stype, tl->term))
+		    return true;
+		}
+	    }
+	}
+      else if (realTermEncrypt (t))
+	{
+	  if (s->type == ENCRYPT)
+	    {
+	      Term key;
+
+	      if (s->symb == NULL)
+		return true;
+	      key = deVar (TermKey (t));
+	      if (realTermVariable (key))
+		return true;
+	      if (s->keytype == LEAF)
+		{
+		  if (realTermLeaf (key) && s->symb == TermSymb (key))
+		    return true;
+		}
+	      else if (realTermEncrypt (key))
+		{
+		  Term f;
+
+		  f = deVar (TermKey (key));
+		  if (realTermVariable (f)
+		      || (realTermLeaf (f) && s->symb == TermSymb (f)))
+		    return true;
+		}
+	    }
+	}
+      else
+	{
+	  if (s->type == TUPLE)
+	    return true;
+	}
+    }
+  return false;
+}
+
 //! Create decryption role instance
 /**
  * Note that this does not add any bindings for the receives.
@@ -888,7 +1251,9 @@ void
 bind_existing_to_goal (const Binding b, const int run, const int index,
 		       int newdecr)
 {
+  Roledef rd;
   Term bigterm;
+  struct sendentry *e;
 
   int unifiesWithKeys (Termlist substlist, Termlist keylist)
   {
@@ -1010,8 +1375,17 @@ bind_existing_to_goal (const Binding b, const int run, const int index,
     return true;
   }
 
-  bigterm = roledef_shift (sys->runs[run].start, index)->message;
-  subtermUnify (bigterm, b->term, NULL, NULL, unifiesWithKeys);
+  rd = roledef_shift (sys->runs[run].start, index);
+  bigterm = rd->message;
+  e = sendIndexFind (rd);
+  if (e != NULL)
+    {
+      sendIndexUnify (e, bigterm, b->term, unifiesWithKeys);
+    }
+  else
+    {
+      subtermUnify (bigterm, b->term, NULL, NULL, unifiesWithKeys);
+    }
 }
 
 
@@ -1366,6 +1740,8 @@ bind_goal_regular_run (const Binding b)
 {
   int flag;
   int found;
+  int i;
+  struct sendentry *e;
 
   /*
    * This is a local function so we have access to goal
@@ -1378,6 +1754,16 @@ bind_goal_regular_run (const Binding b)
       return false;
     }
 
+    int existing_run (void)
+    {
+      return bind_existing_run (b, p, r, index);
+    }
+
+    int new_run (void)
+    {
+      return bind_new_run (b, p, r, index);
+    }
+
     if (p == INTRUDER)
       {
 	// No intruder roles here
@@ -1398,8 +1784,7 @@ bind_goal_regular_run (const Binding b)
 	eprintf (", index %i\n", index);
       }
 #endif
-    if (!subtermUnify
-	(rd->message, b->term, NULL, NULL, test_sub_unification))
+    if (!sendIndexUnify (e, rd->message, b->term, test_sub_unification))
       {
 	int sflag;
 
@@ -1431,14 +1816,14 @@ bind_goal_regular_run (const Binding b)
 	debug (5, "Trying to bind to existing run.");
 #endif
 	proof_go_down (TERM_DeEx, b->term);
-	sflag = bind_existing_run (b, p, r, index);
+	sflag = iterate_alternative (existing_run);
 	proof_go_up ();
 	// bind to new run
 #ifdef DEBUG
 	debug (5, "Trying to bind to new run.");
 #endif
 	proof_go_down (TERM_DeNew, b->term);
-	sflag = sflag && bind_new_run (b, p, r, index);
+	sflag = sflag && iterate_alternative (new_run);
 	proof_go_up ();
 
 	indentDepth--;
@@ -1451,9 +1836,25 @@ bind_goal_regular_run (const Binding b)
   }
 
 
-  // Bind to all possible sends of regular runs
+  // Bind to all possible sends of regular runs, skipping those that
+  // cannot match according to the send index
   found = 0;
-  flag = iterate_role_sends (bind_this_role_send);
+  flag = true;
+  for (i = 0; flag && i < sys->sendcount; i++)
+    {
+      e = &(sys->sends[i]);
+      if (sendIndexMatch (e, b->term))
+	{
+	  flag = bind_this_role_send (e->protocol, e->role, e->rd, e->index);
+	}
+#ifdef DEBUG
+      else
+	{
+	  sendIndexRejects++;
+	}
+      sendIndexChecks++;
+#endif
+    }
   if (switches.output == PROOF && found == 0)
     {
       indentPrint ();
@@ -1513,10 +1914,49 @@ bind_goal_old_intruder_run (Binding b)
   return flag;
 }
 
+//! Explore an alternative of the proof tree, possibly in a parallel task
+/**
+ * \sa taskFork
+ *
+ *@return The result of the alternative. If it was handed off, or if a
+ * parallel task has ended the search, false iff the search was ended.
+ */
+int
+iterate_alternative (int (*alternative) (void))
+{
+  if (tasksStopped ())
+    {
+      return false;
+    }
+  switch (taskFork (sys, proofDepth))
+    {
+    case TASK_PARENT:
+      return !tasksStopped ();
+    case TASK_CHILD:
+      taskExit (sys, alternative ());
+    }
+  return alternative ();
+}
+
 //! Bind a goal in all possible ways
 int
 bind_goal_all_options (const Binding b)
 {
+  int regular_run (void)
+  {
+    return bind_goal_regular_run (b);
+  }
+
+  int old_intruder_run (void)
+  {
+    return bind_goal_old_intruder_run (b);
+  }
+
+  int new_intruder_run (void)
+  {
+    return bind_goal_new_intruder_run (b);
+  }
+
   if (b->blocked)
     {
       error ("Trying to bind a blocked goal!");
@@ -1636,19 +2076,19 @@ bind_goal_all_options (const Binding b)
 	    {
 	      // Special case: only from intruder
 	      proof_go_down (TERM_CoOld, b->term);
-	      flag = flag && bind_goal_old_intruder_run (b);
+	      flag = flag && iterate_alternative (old_intruder_run);
 	      //flag = flag && bind_goal_new_intruder_run (b);
 	      proof_go_up ();
 	    }
 	  else
 	    {
 	      // Normal case
-	      flag = bind_goal_regular_run (b);
+	      flag = iterate_alternative (regular_run);
 	      proof_go_down (TERM_CoOld, b->term);
-	      flag = flag && bind_goal_old_intruder_run (b);
+	      flag = flag && iterate_alternative (old_intruder_run);
 	      proof_go_up ();
 	      proof_go_down (TERM_CoNew, b->term);
-	      flag = flag && bind_goal_new_intruder_run (b);
+	      flag = flag && iterate_alternative (new_intruder_run);
 	      proof_go_up ();
 	    }
 	  proofDepth--;
@@ -1693,7 +2133,7 @@ createNewTermGeneric (Termlist tl, Term t)
     }
 
   /* Make a new term with the free number */
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   memcpy (newterm, t, sizeof (struct term));
   TermRunid (newterm) = freenumber;
 
@@ -1716,8 +2156,16 @@ findUsedConstants (const System sys)
   tlconst = NULL;
   for (run = 0; run < sys->maxruns; run++)
     {
-      tl = termlistAddBasics (tl, sys->runs[run].rho);
-      tl = termlistAddBasics (tl, sys->runs[run].sigma);
+      int i;
+
+      for (i = 0; i < sys->runs[run].rho.length; i++)
+	{
+	  tl = termlistAddBasic (tl, sys->runs[run].rho.terms[i]);
+	}
+      for (i = 0; i < sys->runs[run].sigma.length; i++)
+	{
+	  tl = termlistAddBasic (tl, sys->runs[run].sigma.terms[i]);
+	}
     }
   while (tl != NULL)
     {
@@ -1890,7 +2338,7 @@ deleteNewTerm (Term t)
       /* if it has a positive runid, it did not come from the intruder
        * knowledge, so it must have been constructed.
        */
-      free (t);
+      termFree (t);
     }
 }
 
@@ -2280,14 +2728,13 @@ doAgentUnfolding (const System sys)
 
   for (run = 0; run < sys->maxruns; run++)
     {
-      Termlist tl;
+      int i;
 
-      tl = sys->runs[run].rho;
-      while (tl != NULL)
+      for (i = 0; i < sys->runs[run].rho.length; i++)
 	{
 	  Term t;
 
-	  t = deVar (tl->term);
+	  t = deVar (sys->runs[run].rho.terms[i]);
 	  if (realTermVariable (t))
 	    {
 	      // Hey, this role name is still a variable.
@@ -2295,7 +2742,6 @@ doAgentUnfolding (const System sys)
 	      iterateAgentUnfolding (sys, t);
 	      return false;
 	    }
-	  tl = tl->next;
 	}
     }
   return true;
@@ -2322,9 +2768,33 @@ iterate ()
 	{
 	  if (!prune_bounds (sys))
 	    {
+	      Symmform form;
+
+	      // Skip states that equal an explored one
+	      form = NULL;
+	      if (stateCacheUsed ())
+		{
+		  form = symmetryForm (sys);
+		  if (stateCacheFind (form))
+		    {
+		      if (switches.output == PROOF)
+			{
+			  indentPrint ();
+			  eprintf
+			    ("Pruned because an equivalent state was explored before.\n");
+			}
+		      symmetryFormDelete (form);
+		      return flag;
+		    }
+		}
 
 	      // Go and pick a binding for iteration
 	      flag = iterateOneBinding ();
+
+	      if (form != NULL)
+		{
+		  stateCacheAdd (form);
+		}
 	    }
 	  else
 	    {
@@ -2399,11 +2869,21 @@ arachneClaimTest (Claimlist cl)
   Protocol p;
   Role r;
 
+  if (switches.portfolio > 1)
+    {
+      // Race several heuristics in parallel processes
+      sys->current_claim = cl;
+      arachneClaimPortfolio (sys, cl);
+      return;
+    }
+
   newruns = 0;
   sys->current_claim = cl;
   attack_length = INT_MAX;
   attack_leastcost = INT_MAX;
   cl->complete = 1;
+  stateCacheClear ();
+  knowpointsClear ();
   p = (Protocol) cl->protocol;
   r = (Role) cl->role;
 
@@ -2495,6 +2975,8 @@ arachneClaimTest (Claimlist cl)
       semiRunDestroy ();
       newruns--;
     }
+  // Collect the results of any parallel tasks for this claim
+  tasksWait (sys);
 #ifdef DEBUG
   if (sys->bindings != NULL)
     {
@@ -2510,6 +2992,9 @@ arachneClaimTest (Claimlist cl)
     }
 #endif
 
+  // The search has freed its nodes: return the empty chunks
+  slabsTrim ();
+
   //! Indent back
   indentDepth--;
 
@@ -2547,20 +3032,15 @@ arachneClaim ()
 }
 
 
-//! Main code for Arachne
+//! Prepare the engine for testing claims
 /**
- * For this test, we manually set up some stuff.
- *
- * But later, this will just iterate over all claims.
- *
- * @TODO what does it return? And is that -1 valid, if nothing is tested?
+ * Assumes the system has been set up by arachneInit(), systemReset() and
+ * systemRuns(). After this, claims can be tested one by one with
+ * arachneClaim().
  */
-int
-arachne ()
+void
+arachneSetup ()
 {
-  Claimlist cl;
-  int count;
-
   int print_send (Protocol p, Role r, Roledef rd, int index)
   {
     eprintf ("IRS: ");
@@ -2591,16 +3071,6 @@ arachne ()
     return 1;
   }
 
-  /*
-   * set up claim role(s)
-   */
-
-  if (switches.runs == 0)
-    {
-      // No real checking.
-      return -1;
-    }
-
   if (sys->maxruns > 0)
     {
       error ("Something is wrong, number of runs >0.");
@@ -2619,9 +3089,45 @@ arachne ()
 #endif
 
   fixAgentKeylevels ();
+  symmetryInit (sys);
+  tasksInit ();
 
   indentDepth = 0;
   proofDepth = 0;
+}
+
+//! Main code for Arachne
+/**
+ * For this test, we manually set up some stuff.
+ *
+ * But later, this will just iterate over all claims.
+ *
+ * @TODO what does it return? And is that -1 valid, if nothing is tested?
+ */
+int
+arachne ()
+{
+  Claimlist cl;
+  int count;
+
+  /*
+   * set up claim role(s)
+   */
+
+  if (switches.runs == 0)
+    {
+      // No real checking.
+      return -1;
+    }
+
+  arachneSetup ();
+  if (switches.jobs > 1 && switches.splitDepth <= 0)
+    {
+      // Verify the claims in parallel worker processes; with a split depth,
+      // the job slots go to the proof tree tasks of each claim instead
+      return arachneClaimsParallel (sys);
+    }
+
   cl = sys->claimlist;
   count = 0;
   while (cl != NULL)
@@ -2644,40 +3150,97 @@ arachne ()
   return count;
 }
 
-//! Construct knowledge set at some event, based on a semitrace.
+//! Knowledge at some event, extended incrementally
 /**
- * This is a very 'stupid' algorithm; it is just there because GijsH
- * requested it. It does in no way guarantee that this is the actual
- * knowledge set at the given point. It simply gives an underapproximation,
- * that will be correct in most cases. The main reason for this is that it
- * completely ignores any information on unbound variables, and regards them
- * as bound constants.
- *
- * Because everything is supposed to be bound, we conclude that even 'recv'
- * events imply a certain knowledge.
- *
- * If aftercomplete is 0 or false, we actually check the ordering; otherwise we
- * just assume the trace has finished.
- *
- * Use knowledgeDelete later to clean up.
+ * For each run, the events that precede an event form a prefix of the
+ * run, which only grows for later events of the same run. The knowledge
+ * at an event is therefore kept, and extended with the next events of
+ * each prefix when a later event of the same run is asked for. The
+ * knowledge is rebuilt when the semitrace has changed, which is detected by
+ * the state counter.
  */
-Knowledge
-knowledgeAtArachne (const System sys, const int myrun, const int myindex,
-		    const int aftercomplete)
+struct knowpoint
 {
-  Knowledge know;
+  Knowledge know;		//!< Knowledge at the event, or NULL
+  int *prefix;			//!< Per run, the number of events in know
+  int prefixmax;		//!< Allocated length of prefix
+  System sys;			//!< System of the semitrace
+  Claimlist claim;		//!< Claim under investigation
+  states_t states;		//!< State counter of the semitrace
+  int run;			//!< Run of the event
+  int index;			//!< Index of the event
+};
+
+//! Knowledge at an event, and after the complete semitrace
+static struct knowpoint knowpoints[2];
+
+//! Forget the knowledge at events
+static void
+knowpointsClear (void)
+{
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      knowledgeDelete (knowpoints[i].know);
+      knowpoints[i].know = NULL;
+      free (knowpoints[i].prefix);
+      knowpoints[i].prefix = NULL;
+      knowpoints[i].prefixmax = 0;
+    }
+}
+
+//! Knowledge at an event, or after the complete semitrace
+/**
+ * Read the disclaimer at knowledgeAtArachne(). The result is kept for
+ * later calls, and should not be changed or deleted.
+ */
+static Knowledge
+knowpointGet (const System sys, const int myrun, const int myindex,
+	      const int aftercomplete)
+{
+  struct knowpoint *kp;
   int run;
 
-  know = knowledgeDuplicate (sys->know);	// duplicate initial knowledge
-  run = 0;
-  while (run < sys->maxruns)
+  kp = &knowpoints[aftercomplete ? 1 : 0];
+  if (aftercomplete && myrun >= 0 && myindex <= sys->runs[myrun].height)
+    {
+      // The same for all events
+      return knowpointGet (sys, -1, 0, true);
+    }
+  if (kp->know == NULL || kp->sys != sys || kp->claim != sys->current_claim
+      || kp->states != sys->states || kp->run != myrun
+      || kp->index > myindex || kp->prefixmax < sys->maxruns)
+    {
+      knowledgeDelete (kp->know);
+      kp->know = knowledgeDuplicate (sys->know);	// duplicate initial knowledge
+      if (kp->prefixmax < sys->maxruns)
+	{
+	  free (kp->prefix);
+	  kp->prefix = (int *) malloc (sys->maxruns * sizeof (int));
+	  if (kp->prefix == NULL)
+	    {
+	      error ("Out of memory for the knowledge at an event.");
+	    }
+	  kp->prefixmax = sys->maxruns;
+	}
+      for (run = 0; run < sys->maxruns; run++)
+	{
+	  kp->prefix[run] = 0;
+	}
+      kp->sys = sys;
+      kp->claim = sys->current_claim;
+      kp->states = sys->states;
+      kp->run = myrun;
+    }
+  kp->index = myindex;
+
+  for (run = 0; run < sys->maxruns; run++)
     {
       int index;
       int maxheight;
       Roledef rd;
 
-      index = 0;
-      rd = sys->runs[run].start;
       maxheight = sys->runs[run].height;
       if (run == myrun && myindex > maxheight)
 	{
@@ -2685,34 +3248,61 @@ knowledgeAtArachne (const System sys, const int myrun, const int myindex,
 	  maxheight = myindex;
 	}
 
-      while (rd != NULL && index < maxheight)
+      // Skip the events that are in the knowledge already
+      index = 0;
+      rd = sys->runs[run].start;
+      while (rd != NULL && index < kp->prefix[run])
 	{
-	  // Check whether this event precedes myevent
-	  if (aftercomplete || isDependEvent (run, index, myrun, myindex))
-	    {
-	      // If it is a send (trivial) or a recv (remarkable, but true
-	      // because of bindings) we can add the message and the agents to
-	      // the knowledge.
-	      if (rd->type == SEND || rd->type == RECV)
-		{
-		  knowledgeAddTerm (know, rd->message);
-		  if (rd->from != NULL)
-		    knowledgeAddTerm (know, rd->from);
-		  if (rd->to != NULL)
-		    knowledgeAddTerm (know, rd->to);
-		}
-	      index++;
-	      rd = rd->next;
-	    }
-	  else
+	  index++;
+	  rd = rd->next;
+	}
+
+      // Check whether the next events precede myevent
+      while (rd != NULL && index < maxheight &&
+	     (aftercomplete || isDependEvent (run, index, myrun, myindex)))
+	{
+	  // If it is a send (trivial) or a recv (remarkable, but true
+	  // because of bindings) we can add the message and the agents to
+	  // the knowledge.
+	  if (rd->type == SEND || rd->type == RECV)
 	    {
-	      // Not ordered before anymore, so we skip to the next run.
-	      rd = NULL;
+	      knowledgeAddTerm (kp->know, rd->message);
+	      if (rd->from != NULL)
+		knowledgeAddTerm (kp->know, rd->from);
+	      if (rd->to != NULL)
+		knowledgeAddTerm (kp->know, rd->to);
 	    }
+	  index++;
+	  rd = rd->next;
 	}
-      run++;
+      kp->prefix[run] = index;
     }
-  return know;
+  return kp->know;
+}
+
+//! Construct knowledge set at some event, based on a semitrace.
+/**
+ * This is a very 'stupid' algorithm; it is just there because GijsH
+ * requested it. It does in no way guarantee that this is the actual
+ * knowledge set at the given point. It simply gives an underapproximation,
+ * that will be correct in most cases. The main reason for this is that it
+ * completely ignores any information on unbound variables, and regards them
+ * as bound constants.
+ *
+ * Because everything is supposed to be bound, we conclude that even 'recv'
+ * events imply a certain knowledge.
+ *
+ * If aftercomplete is 0 or false, we actually check the ordering; otherwise we
+ * just assume the trace has finished.
+ *
+ * Use knowledgeDelete later to clean up.
+ */
+Knowledge
+knowledgeAtArachne (const System sys, const int myrun, const int myindex,
+		    const int aftercomplete)
+{
+  return knowledgeDuplicate (knowpointGet
+			     (sys, myrun, myindex, aftercomplete));
 }
 
 //! Determine whether a term is trivially known at some event in a partially ordered structure.
@@ -2726,13 +3316,7 @@ int
 isTriviallyKnownAtArachne (const System sys, const Term t, const int run,
 			   const int index)
 {
-  int result;
-  Knowledge knowset;
-
-  knowset = knowledgeAtArachne (sys, run, index, false);
-  result = inKnowledge (knowset, t);
-  knowledgeDelete (knowset);
-  return result;
+  return inKnowledge (knowpointGet (sys, run, index, false), t);
 }
 
 //! Determine whether a term is trivially known after execution of some partially ordered structure.
@@ -2746,13 +3330,7 @@ int
 isTriviallyKnownAfterArachne (const System sys, const Term t, const int run,
 			      const int index)
 {
-  int result;
-  Knowledge knowset;
-
-  knowset = knowledgeAtArachne (sys, run, index, true);
-  result = inKnowledge (knowset, t);
-  knowledgeDelete (knowset);
-  return result;
+  return inKnowledge (knowpointGet (sys, run, index, true), t);
 }
 
 //! Mark that we have no full proof
@@ -21,10 +21,16 @@
 #define ARACHNE
 
 #include "system.h"
+#include "context.h"
 
 void arachneInit (const System sys);
 void arachneDone ();
+void arachneContextSave (const VerifierContext ctx);
+void arachneContextLoad (const VerifierContext ctx);
+void arachneSetup ();
 int arachne ();
+int arachneClaim ();
+void arachneClaimTest (Claimlist cl);
 int get_semitrace_length ();
 void indentPrint ();
 int isTriviallyKnownAtArachne (const System sys, const Term t, const int run,
@@ -30,6 +30,7 @@
 #include "debug.h"
 #include "term.h"
 #include "termmap.h"
+#include "termvec.h"
 #include "arachne.h"
 #include "switches.h"
 #include "depend.h"
@@ -38,6 +39,17 @@
 
 static System sys;		//!< local storage of system pointer
 
+//! Entry of the origination index: a tuple component of a bound goal
+struct origin
+{
+  unsigned int hash;		//!< termHash() of the component
+  Term term;			//!< The component
+  Binding b;			//!< The binding it came from
+};
+
+static struct origin *origins = NULL;	//!< origination index, rebuilt per check
+static int originsmax = 0;	//!< allocated size of the index
+
 extern Protocol INTRUDER;	//!< The intruder protocol
 extern Role I_M;		//!< special role; precedes all other events always
 
@@ -62,6 +74,8 @@ binding_create (Term term, int run_to, int ev_to)
   b->ev_to = ev_to;
   b->term = term;
   b->level = 0;
+  b->weighed = false;
+  b->weightkey = NULL;
   return b;
 }
 
@@ -73,6 +87,7 @@ binding_destroy (Binding b)
     {
       goal_unbind (b);
     }
+  termFrozenDelete (b->weightkey);
   free (b);
 }
 
@@ -92,6 +107,13 @@ bindingInit (const System mysys)
   dependInit (sys);
 }
 
+//! Switch to the system of a verifier context
+void
+bindingContextLoad (const VerifierContext ctx)
+{
+  sys = ctx->sys;
+}
+
 //! Close up
 void
 bindingDone ()
@@ -103,6 +125,9 @@ bindingDone ()
   }
   list_iterate (sys->bindings, delete);
   list_destroy (sys->bindings);
+  free (origins);
+  origins = NULL;
+  originsmax = 0;
 
   dependDone (sys);
 }
@@ -426,13 +451,81 @@ iterate_preceding_bindings (const int run, const int ev,
 }
 
 
+//! Order origination index entries by hash
+static int
+origin_compare (const void *p1, const void *p2)
+{
+  const struct origin *o1 = (const struct origin *) p1;
+  const struct origin *o2 = (const struct origin *) p2;
+
+  if (o1->hash < o2->hash)
+    return -1;
+  if (o1->hash > o2->hash)
+    return 1;
+  return 0;
+}
+
+//! Check for unique origination, without intruder
+/*
+ * Without an intruder, the tuple components of a binding are compared to
+ * the complete terms of the bindings before it in the list.
+ *
+ *@returns True, if it's okay. If false, it needs to be pruned.
+ */
+static int
+unique_origination_plain ()
+{
+  List bl;
+
+  for (bl = sys->bindings; bl != NULL; bl = bl->next)
+    {
+      Binding b;
+
+      b = (Binding) bl->data;
+      if (valid_binding (b))
+	{
+	  struct termvec terms;
+	  List bl2;
+
+	  termvecInit (&terms);
+	  termvecAddComponents (&terms, b->term);
+	  for (bl2 = sys->bindings; terms.length > 0 && bl2 != bl;
+	       bl2 = bl2->next)
+	    {
+	      Binding b2;
+
+	      b2 = (Binding) bl2->data;
+	      if (valid_binding (b2) && inTermvec (&terms, b2->term))
+		{
+		  // Equal terms should originate at the same point
+		  if (b->run_from != b2->run_from ||
+		      b->ev_from != b2->ev_from)
+		    {
+		      termvecDone (&terms);
+		      return false;
+		    }
+		}
+	    }
+	  termvecDone (&terms);
+	}
+    }
+  return true;
+}
+
 //! Check for unique origination
 /*
  * Contrary to a previous version, we simply check for unique origination.
- * This immediately takes care of any 'occurs before' things. Complexity is N
- * log N.
+ * This immediately takes care of any 'occurs before' things.
  *
- * Each term should originate only at one point (thus in one binding)
+ * Each term should originate only at one point (thus in one binding). With
+ * an intruder, this holds for each tuple component of the bound goals. The
+ * components are collected in an index sorted by termHash(), so only
+ * components with equal hashes are compared, and the complexity is N log N
+ * in the total number of components.
+ *
+ * The index is rebuilt for each check: later unifications may substitute
+ * the variables of earlier bindings, which changes both their components
+ * and their hashes.
  *
  *@returns True, if it's okay. If false, it needs to be pruned.
  */
@@ -440,10 +533,44 @@ int
 unique_origination ()
 {
   List bl;
+  int n;
+  int i;
 
-  bl = sys->bindings;
+  void add_components (Term t, Binding b)
+  {
+    t = deVar (t);
+    if (t == NULL)
+      return;
+    if (realTermTuple (t))
+      {
+	add_components (TermOp1 (t), b);
+	add_components (TermOp2 (t), b);
+	return;
+      }
+    if (n == originsmax)
+      {
+	originsmax = (originsmax == 0 ? 64 : 2 * originsmax);
+	origins = (struct origin *) realloc (origins,
+					     originsmax *
+					     sizeof (struct origin));
+	if (origins == NULL)
+	  {
+	    error ("Out of memory for the origination index.");
+	  }
+      }
+    origins[n].hash = termHash (t);
+    origins[n].term = t;
+    origins[n].b = b;
+    n++;
+  }
 
-  while (bl != NULL)
+  if (!switches.intruder)
+    {
+      return unique_origination_plain ();
+    }
+
+  n = 0;
+  for (bl = sys->bindings; bl != NULL; bl = bl->next)
     {
       Binding b;
 
@@ -451,66 +578,34 @@ unique_origination ()
       // Check for a valid binding; it has to be 'done' and sensibly bound (not as in tuple expanded stuff)
       if (valid_binding (b))
 	{
-	  Termlist terms;
+	  add_components (b->term, b);
+	}
+    }
+  if (n < 2)
+    {
+      return true;
+    }
+  qsort (origins, n, sizeof (struct origin), origin_compare);
 
-	  terms = tuple_to_termlist (b->term);
-	  if (terms != NULL)
-	    {
-	      /* Apparently this is a good term.
-	       * Now we check whether it occurs in any previous bindings as well.
-	       */
+  for (i = 0; i < n; i++)
+    {
+      int j;
 
-	      List bl2;
+      for (j = i + 1; j < n && origins[j].hash == origins[i].hash; j++)
+	{
+	  Binding b, b2;
 
-	      bl2 = sys->bindings;
-	      while (bl2 != bl)
+	  b = origins[i].b;
+	  b2 = origins[j].b;
+	  if (b->run_from != b2->run_from || b->ev_from != b2->ev_from)
+	    {
+	      if (isTermEqual (origins[i].term, origins[j].term))
 		{
-		  Binding b2;
-
-		  b2 = (Binding) bl2->data;
-		  if (valid_binding (b2))
-		    {
-		      Termlist terms2, sharedterms;
-
-		      if (switches.intruder)
-			{
-			  // For intruder we work with sets here
-			  terms2 = tuple_to_termlist (b2->term);
-			}
-		      else
-			{
-			  // For regular agents we use terms
-			  terms2 = termlistAdd (NULL, b2->term);
-			}
-		      sharedterms = termlistConjunct (terms, terms2);
-
-		      // Compare terms
-		      if (sharedterms != NULL)
-			{
-			  // Apparently, this binding shares a term.
-			  // Equal terms should originate at the same point
-			  if (b->run_from != b2->run_from ||
-			      b->ev_from != b2->ev_from)
-			    {
-			      // Not equal: thus no unique origination.
-
-			      // Cleanup of garbage
-			      termlistDelete (terms2);
-			      termlistDelete (sharedterms);
-			      termlistDelete (terms);
-
-			      return false;
-			    }
-			}
-		      termlistDelete (terms2);
-		      termlistDelete (sharedterms);
-		    }
-		  bl2 = bl2->next;
+		  // Equal terms, but no unique origination.
+		  return false;
 		}
 	    }
-	  termlistDelete (terms);
 	}
-      bl = bl->next;
     }
   return true;
 }
@@ -23,6 +23,7 @@
 #include "term.h"
 #include "termmap.h"
 #include "system.h"
+#include "context.h"
 
 //! Binding structure
 /*
@@ -44,6 +45,11 @@ struct binding
 
   Term term;			//!< Binding term
   int level;			//!< ???
+
+  int weighed;			//!< Iff true, weight holds a cached goal weight
+  unsigned int weighthash;	//!< termHash() of the goal term the weight was computed for
+  Term weightkey;		//!< Frozen copy of that goal term, see termFreeze()
+  float weight;			//!< Cached goal weight, see goalWeight()
 };
 
 typedef struct binding *Binding;	//!< pointer to binding structure
@@ -51,6 +57,7 @@ typedef struct binding *Binding;	//!< pointer to binding structure
 
 void bindingInit (const System mysys);
 void bindingDone ();
+void bindingContextLoad (const VerifierContext ctx);
 
 int binding_print (Binding b);
 int valid_binding (Binding b);
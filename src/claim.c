@@ -154,9 +154,9 @@ __inline__ int
 oki_nisynch_full (const System sys, const Termmap label_to_index)
 {
   // Are all labels well linked?
-  Termmap label_to_index_scan;
+  Termmapnode label_to_index_scan;
 
-  label_to_index_scan = label_to_index;
+  label_to_index_scan = termmapFirst (label_to_index);
   while (label_to_index_scan != NULL)
     {
       if (label_to_index_scan->result != LABEL_GOOD)
@@ -205,7 +205,7 @@ oki_nisynch_recv (const System sys, const int trace_index,
   /*
    * Recv is only relevant for already involved runs, and labels in prec
    */
-  Termmap role_to_run_scan;
+  Termmapnode role_to_run_scan;
   int result = 7;
   Roledef rd;
   int rid;
@@ -213,7 +213,7 @@ oki_nisynch_recv (const System sys, const int trace_index,
   rd = sys->traceEvent[trace_index];
   rid = sys->traceRun[trace_index];
 
-  role_to_run_scan = role_to_run;
+  role_to_run_scan = termmapFirst (role_to_run);
   while (role_to_run_scan != NULL)
     {
       if (role_to_run_scan->result == rid)
@@ -736,8 +736,8 @@ has_weakagree_agent (const System sys, const int claim_run, const Term agent)
 	{
 	  if (isTermEqual (agent, agentOfRun (sys, run)))
 	    {
-	      if (isTermlistSetEqual
-		  (sys->runs[run].rho, sys->runs[claim_run].rho))
+	      if (isTermvecSetEqual
+		  (&(sys->runs[run].rho), &(sys->runs[claim_run].rho)))
 		{
 		  return true;
 		}
@@ -759,13 +759,13 @@ arachne_claim_weakagree (const System sys, const int claim_run,
   if (sys->current_claim->parameter == NULL)
     {
       // No parameter: need agents for all roles
-      Termlist tl;
+      int i;
 
-      for (tl = sys->runs[claim_run].rho; tl != NULL; tl = tl->next)
+      for (i = 0; i < sys->runs[claim_run].rho.length; i++)
 	{
 	  Term agent;
 
-	  agent = tl->term;
+	  agent = sys->runs[claim_run].rho.terms[i];
 	  if (!has_weakagree_agent (sys, claim_run, agent))
 	    {
 	      return false;
@@ -902,11 +902,11 @@ arachne_claim_alive (const System sys, const int claim_run,
   if (sys->current_claim->parameter == NULL)
     {
       // No parameter: check for all roles
-      Termlist tl;
+      int i;
 
-      for (tl = sys->runs[claim_run].rho; tl != NULL; tl = tl->next)
+      for (i = 0; i < sys->runs[claim_run].rho.length; i++)
 	{
-	  if (!is_agent_alive (sys, tl->term))
+	  if (!is_agent_alive (sys, sys->runs[claim_run].rho.terms[i]))
 	    {
 	      return false;
 	    }
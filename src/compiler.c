@@ -1582,14 +1582,10 @@ tacProcess (Tac tc)
 Term
 tacTerm (Tac tc)
 {
-  Term t;
-
   switch (tc->op)
     {
     case TAC_FCALL:
-      t = makeTermEncrypt (tacTerm (tc->t1.tac), tacTerm (tc->t2.tac));
-      t->helper.fcall = true;
-      return t;
+      return makeTermFcall (tacTerm (tc->t1.tac), tacTerm (tc->t2.tac));
     case TAC_ENCRYPT:
       return makeTermEncrypt (tacTerm (tc->t1.tac), tacTerm (tc->t2.tac));
     case TAC_TUPLE:
@@ -1800,7 +1796,7 @@ void
 compute_prec_sets (const System sys)
 {
   Term *eventlabels;		// array: maps events to labels
-  unsigned int *prec;		// array: maps event*event to precedence
+  bitword *prec;		// array: maps event*event to precedence
   int size;			// temp constant: rolecount * roleeventmax
   int rowsize;
   int r1, r2, ev1, ev2;		// some counters
@@ -1897,7 +1893,7 @@ compute_prec_sets (const System sys)
   size = sys->rolecount * sys->roleeventmax;
   rowsize = WORDSIZE (size);
   eventlabels = malloc (size * sizeof (Term));
-  prec = (unsigned int *) CALLOC (1, rowsize * size * sizeof (unsigned int));
+  prec = (bitword *) CALLOC (1, rowsize * size * sizeof (bitword));
   // Assign labels
   r1 = 0;
   while (r1 < sys->rolecount)
@@ -0,0 +1,93 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *@file context.c
+ * \brief Verifier contexts
+ *
+ * Save and restore the state of the loaded system and its settings, for the
+ * single active verification of the process. \sa struct verifiercontext
+ */
+
+#include <stdlib.h>
+#include "context.h"
+#include "arachne.h"
+#include "binding.h"
+#include "depend.h"
+#include "symbol.h"
+#include "timer.h"
+#include "error.h"
+
+//! Create a new context, holding a copy of the current engine state.
+/**
+ * Typically called after the system has been compiled and arachneInit() has
+ * been called, so that the context can be loaded again later.
+ */
+VerifierContext
+contextCreate (void)
+{
+  VerifierContext ctx;
+
+  ctx = (VerifierContext) malloc (sizeof (struct verifiercontext));
+  if (ctx == NULL)
+    {
+      error ("Could not allocate a verifier context.");
+    }
+  contextSave (ctx);
+  return ctx;
+}
+
+//! Store the current engine state in a context.
+void
+contextSave (const VerifierContext ctx)
+{
+  ctx->switches = switches;
+  ctx->globalStream = globalStream;
+  ctx->globalError = globalError;
+  ctx->timeLimit = get_time_limit ();
+  arachneContextSave (ctx);
+  dependContextSave (ctx);
+}
+
+//! Make a context the current engine state.
+/**
+ * The currently active state should be saved first if it is still needed.
+ */
+void
+contextLoad (const VerifierContext ctx)
+{
+  switches = ctx->switches;
+  globalStream = ctx->globalStream;
+  globalError = ctx->globalError;
+  set_time_limit (ctx->timeLimit);
+  arachneContextLoad (ctx);
+  bindingContextLoad (ctx);
+  dependContextLoad (ctx);
+}
+
+//! Destroy a context.
+/**
+ * The system and the dependency graph stack are not owned by the context
+ * memory itself; they are cleaned up as usual by systemDone().
+ */
+void
+contextDestroy (const VerifierContext ctx)
+{
+  free (ctx);
+}
@@ -0,0 +1,89 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef CONTEXT
+#define CONTEXT
+
+#include <stdio.h>
+#include "system.h"
+#include "switches.h"
+
+//! All mutable engine state of a single verification.
+/**
+ * The engine modules keep their state in process globals, which is what they
+ * work on while verifying. A verifier context holds a copy of the part of
+ * that state that describes the loaded system and its settings, so that it
+ * can be restored between verifications, e.g. to reset the switches given
+ * for a single claim.
+ *
+ * This is not a reentrant engine: there is one active verification per
+ * process, and contexts must not be used from several threads. Saving and
+ * loading swaps process globals, and the following engine-wide state is not
+ * captured at all; it belongs to whichever verification runs, and is reset
+ * per claim or torn down by arachneDone() and the module *Done() functions:
+ * - the state cache and symmetry buffers (statecache.c, symmetry.c)
+ * - the hidelevel memo (hidelevel.c)
+ * - the knowpoints (arachne.c)
+ * - the unifier trail and work stacks (mgu.c)
+ * - the term intern table and the slabs (term.c, slab.c)
+ * - the origination index of the bindings (binding.c)
+ * - the job token pipe and the proof tree tasks (jobs.c)
+ *
+ * For parallel verification, use the process-based parallelism of jobs.c.
+ */
+struct verifiercontext
+{
+  //! The system under verification
+  System sys;
+  //! Command-line switches in effect
+  struct switchdata switches;
+  //! Output stream and error redirection (symbol.c)
+  char *globalStream;
+  int globalError;
+  //! Time limit in seconds, or 0 if none (timer.c)
+  int timeLimit;
+
+  //! Intruder protocol and roles (arachne.c)
+  Protocol intruder;
+  Role intruderM;
+  Role intruderRRS;
+  Role intruderRRSD;
+  //! Search state (arachne.c)
+  int attackLength;
+  int attackLeastcost;
+  int proofDepth;
+  int maxEncryptionLevel;
+  int indentDepth;
+  int prevIndentDepth;
+  int indentDepthChanges;
+  FILE *attackStream;
+
+  //! Dependency graph stack (depend.c)
+  struct dependstack *depstack;
+};
+
+//! Shorthand for context pointer.
+typedef struct verifiercontext *VerifierContext;
+
+VerifierContext contextCreate (void);
+void contextSave (const VerifierContext ctx);
+void contextLoad (const VerifierContext ctx);
+void contextDestroy (const VerifierContext ctx);
+
+#endif
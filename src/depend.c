@@ -50,14 +50,59 @@ struct depeventgraph
   int n;
   //! Rowsize
   int rowsize;
-  //! Graph structure
-  unsigned int *G;
+  //! Graph structure, as an offset in the arena
+  size_t G;
+  //! True iff the graph is transitively closed
+  int closed;
+  //! Size of the arena and the trail before this graph was pushed
+  size_t arenamark;
+  int trailmark;
   //! Zombie dummy push
   int zombie;
-  //! Previous graph
-  struct depeventgraph *prev;
 };
 
+//! A word of a graph changed by an event push, to be restored by the pop
+struct dependtrail
+{
+  size_t word;			//!< Offset of the word in the arena
+  bitword old;			//!< Previous contents
+};
+
+//! The stack of dependency graphs
+/**
+ * Pushes and pops happen for every binding during the search, so nothing is
+ * allocated for them: the graphs, their matrices and the trail of changed
+ * words live in arrays that are kept, and only grow when needed.
+ *
+ * A run push stacks a new matrix on the arena. An event push on a closed
+ * graph changes the matrix in place, recording the old contents of the
+ * changed words on the trail; popping restores them. Only the first event
+ * push after a run push copies the matrix, because it has to compute the
+ * closure from scratch.
+ */
+struct dependstack
+{
+  struct depeventgraph *graphs;	//!< graphs[0] is the bottom of the stack
+  int count;
+  int max;
+  bitword *arena;		//!< Stacked matrices
+  size_t arenaused;
+  size_t arenasize;
+  struct dependtrail *trail;	//!< Changed words
+  int trailused;
+  int trailmax;
+};
+
+//! Number of runs the arena is initially sized for
+/**
+ * The arena cannot be sized from sys->maxruns, as that is the number of runs
+ * in the current semitrace, which is 0 when the first graph is pushed; the
+ * run bound (switches.runs) is unbounded (INT_MAX) with --max-runs=0. So the
+ * arena starts at a size that covers typical searches, and doubles when a
+ * deeper one needs more.
+ */
+#define DEPEND_RUNS_INITIAL 8
+
 //! Pointer shorthard
 typedef struct depeventgraph *Depeventgraph;
 
@@ -74,8 +119,14 @@ extern Role I_M;		//!< special role; precedes all other events always
  * ---------------------------------------------------------------
  */
 
+//! The stack
+static struct dependstack *depstack = NULL;
+//! The top of the stack, or NULL if empty
 Depeventgraph currentdepgraph = NULL;
 
+//! Graph structure of a graph
+#define GRAPH(dg) (depstack->arena + (dg)->G)
+
 /*
  * Default code
  * ---------------------------------------------------------------
@@ -85,18 +136,52 @@ Depeventgraph currentdepgraph = NULL;
 void
 dependInit (const System sys)
 {
+  depstack = (struct dependstack *) MALLOC (sizeof (struct dependstack));
+  depstack->graphs = NULL;
+  depstack->count = 0;
+  depstack->max = 0;
+  depstack->arena = NULL;
+  depstack->arenaused = 0;
+  depstack->arenasize = 0;
+  depstack->trail = NULL;
+  depstack->trailused = 0;
+  depstack->trailmax = 0;
   currentdepgraph = NULL;
 }
 
+//! Store the dependency graph stack in a verifier context
+void
+dependContextSave (const VerifierContext ctx)
+{
+  ctx->depstack = depstack;
+}
+
+//! Restore the dependency graph stack from a verifier context
+void
+dependContextLoad (const VerifierContext ctx)
+{
+  depstack = ctx->depstack;
+  if (depstack->count > 0)
+    {
+      currentdepgraph = &depstack->graphs[depstack->count - 1];
+    }
+  else
+    {
+      currentdepgraph = NULL;
+    }
+}
+
 //! Pring
 void
 dependPrint ()
 {
   Depeventgraph dg;
+  int i;
 
   eprintf ("Printing DependEvent stack, top first.\n\n");
-  for (dg = currentdepgraph; dg != NULL; dg = dg->prev)
+  for (i = depstack->count - 1; i >= 0; i--)
     {
+      dg = &depstack->graphs[i];
       eprintf ("%i nodes, %i rowsize, %i zombies, %i runs: created for new ",
 	       dg->n, dg->rowsize, dg->zombie, dg->runs);
       if (dg->fornewrun)
@@ -166,6 +251,11 @@ dependDone (const System sys)
       error
 	("depgraph stack (depend.c) not empty at dependDone, bad iteration?");
     }
+  FREE (depstack->graphs);
+  FREE (depstack->arena);
+  FREE (depstack->trail);
+  FREE (depstack);
+  depstack = NULL;
 }
 
 /*
@@ -226,62 +316,104 @@ getGraphSize (const Depeventgraph dgx)
   return (dgx->n * dgx->rowsize);
 }
 
-//! Create graph from sys
-Depeventgraph
-dependCreate (const System sys)
+//! Make room for a number of words on the arena
+static void
+dependReserve (const size_t words)
 {
-  Depeventgraph dgnew;
+  size_t size;
 
-  dgnew = (Depeventgraph) MALLOC (sizeof (struct depeventgraph));
-  dgnew->sys = sys;
-  dgnew->fornewrun = true;
-  dgnew->runs = sys->maxruns;
-  dgnew->zombie = 0;
-  dgnew->prev = NULL;
-  dgnew->n = countnodes (dgnew);	// count nodes works on ->sys
-  dgnew->rowsize = WORDSIZE (dgnew->n);
-  dgnew->G = (unsigned int *) CALLOC (1, getGraphSize (dgnew) * sizeof (unsigned int));	// works on ->n and ->rowsize
+  if (depstack->arenaused + words <= depstack->arenasize)
+    {
+      return;
+    }
+  size = 2 * depstack->arenasize;
+  if (depstack->arena == NULL)
+    {
+      int n;
 
-  return dgnew;
+      // A run push stacks a graph, and the first event push after it a
+      // copy, so a search up to DEPEND_RUNS_INITIAL runs stacks at most
+      // twice that many graphs of at most n nodes
+      n = DEPEND_RUNS_INITIAL * currentdepgraph->sys->roleeventmax;
+      size = 2 * DEPEND_RUNS_INITIAL * n * WORDSIZE (n);
+    }
+  if (size < depstack->arenaused + words)
+    {
+      size = depstack->arenaused + words;
+    }
+  depstack->arena =
+    (bitword *) realloc (depstack->arena, size * sizeof (bitword));
+  if (depstack->arena == NULL)
+    {
+      error ("Could not grow the dependency graph arena.");
+    }
+  depstack->arenasize = size;
 }
 
-//! Copy graph from current one
-Depeventgraph
-dependCopy (const Depeventgraph dgold)
+//! Allocate a graph structure on the arena for the current graph
+static void
+dependAllocate (void)
 {
-  Depeventgraph dgnew;
-
-  // Copy old to new
-  dgnew = (Depeventgraph) MALLOC (sizeof (struct depeventgraph));
-  memcpy ((void *) dgnew, (void *) dgold,
-	  (size_t) sizeof (struct depeventgraph));
-
-  // New copy
-  dgnew->fornewrun = false;
-  dgnew->zombie = 0;
-
-  // copy inner graph
-  dgnew->G =
-    (unsigned int *) MALLOC (getGraphSize (dgold) * sizeof (unsigned int));
-  memcpy ((void *) dgnew->G, (void *) dgold->G,
-	  getGraphSize (dgold) * sizeof (unsigned int));
-
-  return dgnew;
+  dependReserve (getGraphSize (currentdepgraph));
+  currentdepgraph->G = depstack->arenaused;
+  depstack->arenaused += getGraphSize (currentdepgraph);
 }
 
-//! Destroy graph
-void
-dependDestroy (const Depeventgraph dgold)
+//! Change a word of the current graph, recording the old contents on the trail
+static void
+dependTrailSet (bitword * word, const bitword value)
 {
-  FREE (dgold->G);
-  FREE (dgold);
+  struct dependtrail *t;
+
+  if (depstack->trailused >= depstack->trailmax)
+    {
+      depstack->trailmax =
+	(depstack->trailmax == 0 ? 1024 : 2 * depstack->trailmax);
+      depstack->trail = (struct dependtrail *)
+	realloc (depstack->trail,
+		 depstack->trailmax * sizeof (struct dependtrail));
+      if (depstack->trail == NULL)
+	{
+	  error ("Could not grow the dependency graph trail.");
+	}
+    }
+  t = &depstack->trail[depstack->trailused++];
+  t->word = word - depstack->arena;
+  t->old = *word;
+  *word = value;
 }
 
 //! push graph to stack (generic)
+/**
+ * The new graph starts as a copy of the previous one, sharing its graph
+ * structure.
+ */
 void
-dependPushGeneric (Depeventgraph dgnew)
+dependPushGeneric (void)
 {
-  dgnew->prev = currentdepgraph;
+  Depeventgraph dgnew;
+
+  if (depstack->count >= depstack->max)
+    {
+      depstack->max = (depstack->max == 0 ? 64 : 2 * depstack->max);
+      depstack->graphs = (struct depeventgraph *)
+	realloc (depstack->graphs, depstack->max * sizeof (struct depeventgraph));
+      if (depstack->graphs == NULL)
+	{
+	  error ("Could not grow the dependency graph stack.");
+	}
+    }
+  dgnew = &depstack->graphs[depstack->count];
+  if (depstack->count > 0)
+    {
+      memcpy ((void *) dgnew, (void *) &depstack->graphs[depstack->count - 1],
+	      (size_t) sizeof (struct depeventgraph));
+    }
+  dgnew->fornewrun = false;
+  dgnew->zombie = 0;
+  dgnew->arenamark = depstack->arenaused;
+  dgnew->trailmark = depstack->trailused;
+  depstack->count++;
   currentdepgraph = dgnew;
 }
 
@@ -289,11 +421,24 @@ dependPushGeneric (Depeventgraph dgnew)
 void
 dependPopGeneric (void)
 {
-  Depeventgraph dgprev;
+  // undo changed words, newest first
+  while (depstack->trailused > currentdepgraph->trailmark)
+    {
+      struct dependtrail *t;
 
-  dgprev = currentdepgraph->prev;
-  dependDestroy (currentdepgraph);
-  currentdepgraph = dgprev;
+      t = &depstack->trail[--depstack->trailused];
+      depstack->arena[t->word] = t->old;
+    }
+  depstack->arenaused = currentdepgraph->arenamark;
+  depstack->count--;
+  if (depstack->count > 0)
+    {
+      currentdepgraph = &depstack->graphs[depstack->count - 1];
+    }
+  else
+    {
+      currentdepgraph = NULL;
+    }
 }
 
 // Dependencies from role order
@@ -352,19 +497,66 @@ dependFromSys (void)
   dependDefaultBindingOrder ();
 }
 
+//! Add an edge n1 -> n2 to a closed graph, keeping it closed
+/**
+ * In a closed graph, the new paths are exactly those from n1 or any of its
+ * predecessors, to n2 or any of its successors. So instead of recomputing
+ * the closure, we OR the row of n2 (plus n2 itself) into the rows of those
+ * nodes, recording the changed words on the trail.
+ */
+static void
+dependAddClosed (const int n1, const int n2)
+{
+  bitword *succ;
+  bitword *row;
+  int rowsize;
+  int i;
+  int w;
+
+  rowsize = currentdepgraph->rowsize;
+
+  // successors of n2, plus n2 itself, in the free space at the top of the
+  // arena
+  dependReserve (rowsize);
+  succ = depstack->arena + depstack->arenaused;
+  memcpy ((void *) succ, (void *) (GRAPH (currentdepgraph) + rowsize * n2),
+	  rowsize * sizeof (bitword));
+  SETBIT (succ, n2);
+
+  for (i = 0; i < currentdepgraph->n; i++)
+    {
+      row = GRAPH (currentdepgraph) + rowsize * i;
+      if (i == n1 || BIT (row, n1))
+	{
+	  for (w = 0; w < rowsize; w++)
+	    {
+	      if ((row[w] | succ[w]) != row[w])
+		{
+		  dependTrailSet (row + w, row[w] | succ[w]);
+		}
+	    }
+	}
+    }
+}
+
 //! Detect whether the graph has a cycle. If so, a node can get to itself (through the cycle)
 int
 hasCycle ()
 {
+  bitword *row;
+  int rowsize;
   int n;
 
+  // walk the diagonal directly, one row further and one bit on per node
+  rowsize = currentdepgraph->rowsize;
+  row = GRAPH (currentdepgraph);
   for (n = 0; n < currentdepgraph->n; n++)
     {
-      if (getNode (n, n))
+      if (BIT (row, n))
 	{
 	  return true;
 	}
-
+      row += rowsize;
     }
   return false;
 }
@@ -378,14 +570,14 @@ hasCycle ()
 int
 getNode (const int n1, const int n2)
 {
-  return BIT (currentdepgraph->G + currentdepgraph->rowsize * n1, n2);
+  return BIT (GRAPH (currentdepgraph) + currentdepgraph->rowsize * n1, n2);
 }
 
 //! set node
 void
 setNode (const int n1, const int n2)
 {
-  SETBIT (currentdepgraph->G + currentdepgraph->rowsize * n1, n2);
+  SETBIT (GRAPH (currentdepgraph) + currentdepgraph->rowsize * n1, n2);
 }
 
 //! Count nodes
@@ -428,7 +620,16 @@ dependPushRun (const System sys)
 #ifdef DEBUG
   debug (5, "Push dependGraph for new run\n");
 #endif
-  dependPushGeneric (dependCreate (sys));
+  dependPushGeneric ();
+  currentdepgraph->sys = sys;
+  currentdepgraph->fornewrun = true;
+  currentdepgraph->runs = sys->maxruns;
+  currentdepgraph->closed = false;
+  currentdepgraph->n = countnodes (currentdepgraph);	// count nodes works on ->sys
+  currentdepgraph->rowsize = WORDSIZE (currentdepgraph->n);
+  dependAllocate ();		// works on ->n and ->rowsize
+  memset ((void *) GRAPH (currentdepgraph), 0,
+	  getGraphSize (currentdepgraph) * sizeof (bitword));
   dependFromSys ();
 }
 
@@ -495,15 +696,31 @@ dependPushEvent (const int r1, const int e1, const int r2, const int e2)
 	}
       else
 	{
-	  // change: make new graph copy of the old one
-	  dependPushGeneric (dependCopy (currentdepgraph));
-	  // really new?
-	  if (!isDependEvent (r1, e1, r2, e2))
+	  // change: the binding is new (see above)
+	  if (currentdepgraph->closed)
 	    {
-	      // add new binding
+	      // add new binding, and update the closure in place. In a
+	      // closed graph, the reverse check above is exact, so this
+	      // cannot introduce a cycle.
+	      dependPushGeneric ();
+	      dependAddClosed (eventtonode (currentdepgraph, r1, e1),
+			       eventtonode (currentdepgraph, r2, e2));
+	    }
+	  else
+	    {
+	      // graph of a new run is not closed yet: make new graph copy of
+	      // the old one, add new binding, and compute the closure
+	      size_t old;
+
+	      dependPushGeneric ();
+	      old = currentdepgraph->G;
+	      dependAllocate ();
+	      memcpy ((void *) GRAPH (currentdepgraph),
+		      (void *) (depstack->arena + old),
+		      getGraphSize (currentdepgraph) * sizeof (bitword));
 	      setDependEvent (r1, e1, r2, e2);
-	      // recompute closure
-	      transitive_closure (currentdepgraph->G, currentdepgraph->n);
+	      transitive_closure (GRAPH (currentdepgraph), currentdepgraph->n);
+	      currentdepgraph->closed = true;
 	      // check for cycles
 	      if (hasCycle ())
 		{
@@ -512,16 +729,16 @@ dependPushEvent (const int r1, const int e1, const int r2, const int e2)
 		  dependPopEvent ();
 		  return false;
 		}
+	    }
 #ifdef DEBUG
-	      debug (5, "Push dependGraph for new event (real push)\n");
-	      if (DEBUGL (5))
-		{
-		  globalError++;
-		  eprintf ("r%ii%i --> r%ii%i\n", r1, e1, r2, e2);
-		  globalError--;
-		}
-#endif
+	  debug (5, "Push dependGraph for new event (real push)\n");
+	  if (DEBUGL (5))
+	    {
+	      globalError++;
+	      eprintf ("r%ii%i --> r%ii%i\n", r1, e1, r2, e2);
+	      globalError--;
 	    }
+#endif
 	}
       return true;
     }
@@ -21,6 +21,7 @@
 #define DEPEND
 
 #include "system.h"
+#include "context.h"
 
 /*
  * The code here mainly involves an interface for creating graphs etc., but
@@ -31,6 +32,8 @@
 void dependInit (const System sys);
 void dependPrint ();
 void dependDone (const System sys);
+void dependContextSave (const VerifierContext ctx);
+void dependContextLoad (const VerifierContext ctx);
 
 /*
  * The push code returns true or false: if false, the operation fails because
@@ -933,7 +933,7 @@ drawClass (const System sys, Binding b)
     run = TermRunid (varterm);
     if ((run >= 0) && (run < sys->maxruns))
       {
-	if (inTermlist (sys->runs[run].rho, varterm))
+	if (inTermvec (&(sys->runs[run].rho), varterm))
 	  {
 	    return;
 	  }
@@ -1403,9 +1403,11 @@ printRunExplanation (const System sys, const int run,
      */
     int numroles;
     int ignoreactor;
+    Termlist rho;
 
     ignoreactor = false;	// set to true to ignore the actor
-    numroles = termlistLength (sys->runs[run].rho);
+    rho = termvecToTermlist (&(sys->runs[run].rho));
+    numroles = termlistLength (rho);
 
     if (numroles > 1)
       {
@@ -1422,9 +1424,10 @@ printRunExplanation (const System sys, const int run,
 	    }
 	  hadcontent =
 	    showLocals (run, sys->runs[run].protocol->rolenames,
-			sys->runs[run].rho, ignoreterm, "", "\\l");
+			rho, ignoreterm, "", "\\l");
 	}
       }
+    termlistDelete (rho);
   }
 
   if (hadcontent)
@@ -1435,20 +1438,26 @@ printRunExplanation (const System sys, const int run,
     }
   hadcontent = printRunConstants (sys, run);
 
-  if (sys->runs[run].sigma != NULL)
-    {
-      if (hadcontent)
-	{
-	  eprintf (newline);
-	  hadcontent = false;
-	}
-      if (showLocals
-	  (run, sys->runs[run].role->declaredvars, sys->runs[run].sigma, NULL,
-	   "Var ", "\\l"))
-	{
-	  eprintf ("\\l");
-	}
-    }
+  {
+    Termlist sigma;
+
+    sigma = termvecToTermlist (&(sys->runs[run].sigma));
+    if (sigma != NULL)
+      {
+	if (hadcontent)
+	  {
+	    eprintf (newline);
+	    hadcontent = false;
+	  }
+	if (showLocals
+	    (run, sys->runs[run].role->declaredvars, sigma, NULL,
+	     "Var ", "\\l"))
+	  {
+	    eprintf ("\\l");
+	  }
+      }
+    termlistDelete (sigma);
+  }
 }
 
 //! Draw regular runs
@@ -22,10 +22,21 @@
 #include <stdarg.h>
 #include "error.h"
 
+//! If set, fatal errors return here instead of exiting (see libscyther.c)
+jmp_buf *error_jump = NULL;
+
 //! Die from error with exit code
+/**
+ * When the verifier is embedded, the host process must survive a bad input,
+ * so we jump back to the library entry point instead.
+ */
 void
 error_die (void)
 {
+  if (error_jump != NULL)
+    {
+      longjmp (*error_jump, 1);
+    }
   exit (EXIT_ERROR);
 }
 
@@ -75,7 +86,7 @@ error_post (char *fmt, ...)
   vprintfstderr (fmt, args);
   printfstderr ("\n");
   va_end (args);
-  exit (EXIT_ERROR);
+  error_die ();
 }
 
 //! Print error message and die.
@@ -20,6 +20,8 @@
 #ifndef ERROR
 #define ERROR
 
+#include <setjmp.h>
+
 //! usestderr is defined iff we use it
 #define USESTDERR
 
@@ -27,6 +29,8 @@
 enum exittypes
 { EXIT_NOATTACK = 0, EXIT_ERROR = 1, EXIT_ATTACK = 3 };
 
+extern jmp_buf *error_jump;
+
 void vprintfstderr (char *fmt, va_list args);
 void printfstderr (char *fmt, ...);
 void error_die (void);
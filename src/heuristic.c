@@ -27,6 +27,8 @@
 
 #include <float.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "binding.h"
 #include "system.h"
@@ -36,6 +38,20 @@
 #include "arachne.h"
 #include "error.h"
 #include "knowledge.h"
+#include "heuristic.h"
+
+//! Goal features that can be weighed by a --heuristic-weights file
+enum goalfeatures
+{ GF_HIDELEVEL, GF_KEYLEVEL, GF_CONSTRAIN, GF_NONCEVARS, GF_CONSTCOUNT,
+  GF_SKKLEVEL, GF_COUNT
+};
+
+//! Names of the goal features, as used in the weights file
+static char *featurenames[GF_COUNT] = {
+  "hidelevel", "keylevel", "constrain", "noncevars", "constcount", "skklevel"
+};
+
+static float featureweights[GF_COUNT];	//!< Weights read from the file
 
 //! Trivial goal detection
 /**
@@ -393,16 +409,140 @@ computeGoalWeight (const System sys, const Binding b)
   return w;
 }
 
+//! Determine the weight of a goal from the feature weights file
+/**
+ * Weighs the same features as the heuristic mask, but with arbitrary
+ * factors, so goal orderings can be tuned without recompiling. The default
+ * mask 674 corresponds to the weights
+ *
+ *	keylevel 0.5
+ *	constcount 1
+ *	hidelevel 4
+ *	skklevel 16
+ *
+ * Features with weight 0 are not computed.
+ */
+float
+computeFeatureWeight (const System sys, const Binding b)
+{
+  float w;
+  Term t;
+
+  w = 0;
+  t = b->term;
+  if (featureweights[GF_HIDELEVEL] != 0)
+    w += featureweights[GF_HIDELEVEL] * weighHidelevel (sys, t, 0.5, 0.5);
+  if (featureweights[GF_KEYLEVEL] != 0)
+    w += featureweights[GF_KEYLEVEL] * (1 - b->level);
+  if (featureweights[GF_CONSTRAIN] != 0)
+    w += featureweights[GF_CONSTRAIN] * term_constrain_level (t);
+  if (featureweights[GF_NONCEVARS] != 0)
+    w += featureweights[GF_NONCEVARS] * term_noncevariables_level (t);
+  if (featureweights[GF_CONSTCOUNT] != 0)
+    w += featureweights[GF_CONSTCOUNT] * term_constcount (sys, t);
+  if (featureweights[GF_SKKLEVEL] != 0)
+    w += featureweights[GF_SKKLEVEL] * term_skk_level (sys, t);
+  return w;
+}
+
+//! Read the feature weights file
+/**
+ * Each line holds a feature name and its weight, e.g. "hidelevel 4".
+ * Empty lines and lines starting with '#' are ignored, and features that
+ * are not mentioned get weight 0.
+ */
+void
+loadFeatureWeights (char *filename)
+{
+  FILE *fp;
+  char line[256];
+  int lineno;
+  int i;
+
+  fp = fopen (filename, "r");
+  if (fp == NULL)
+    {
+      error ("Could not open heuristic weights file %s.", filename);
+    }
+  for (i = 0; i < GF_COUNT; i++)
+    {
+      featureweights[i] = 0;
+    }
+  lineno = 0;
+  while (fgets (line, sizeof (line), fp) != NULL)
+    {
+      char name[64];
+      float weight;
+      int n;
+
+      lineno++;
+      n = sscanf (line, " %63s %f", name, &weight);
+      if (n <= 0 || name[0] == '#')
+	{
+	  continue;
+	}
+      if (n != 2)
+	{
+	  error ("Expected a feature and a weight on line %i of %s.", lineno,
+		 filename);
+	}
+      for (i = 0; i < GF_COUNT; i++)
+	{
+	  if (strcmp (name, featurenames[i]) == 0)
+	    {
+	      featureweights[i] = weight;
+	      break;
+	    }
+	}
+      if (i == GF_COUNT)
+	{
+	  error ("Unknown goal feature '%s' on line %i of %s.", name, lineno,
+		 filename);
+	}
+    }
+  fclose (fp);
+}
+
+//! Determine the weight of a goal, reusing the previous result if possible
+/**
+ * The weight only depends on the goal term as instantiated by the current
+ * substitutions. It is cached in the binding along with a frozen copy of
+ * that instance, so it is only recomputed once a substitution has touched
+ * the variables of the goal. The termHash() of the instance is kept as
+ * well, so that most changes are noticed without comparing the terms. A
+ * claim is verified with a single weighing function, so the cache need not
+ * record which one was used.
+ */
+float
+goalWeight (const System sys, const Binding b,
+	    float (*weigh) (const System sys, const Binding b))
+{
+  unsigned int h;
+
+  h = termHash (b->term);
+  if (!b->weighed || b->weighthash != h
+      || !isTermFrozenEqual (b->weightkey, b->term))
+    {
+      b->weight = weigh (sys, b);
+      b->weighthash = h;
+      termFrozenDelete (b->weightkey);
+      b->weightkey = termFreeze (b->term);
+      b->weighed = true;
+    }
+  return b->weight;
+}
+
 //! Goal selection
 /**
- * Selects the most constrained goal.
+ * Selects the most constrained goal, i.e. the one with the lowest weight.
  *
  * Because the list starts with the newest terms, and we use <= (as opposed to <), we
  * ensure that for goals with equal constraint levels, we select the oldest one.
  *
  */
 Binding
-select_goal_masked (const System sys)
+select_goal_lightest (const System sys,
+		      float (*weigh) (const System sys, const Binding b))
 {
   List bl;
   Binding best;
@@ -428,7 +568,7 @@ select_goal_masked (const System sys)
 	{
 	  float w;
 
-	  w = computeGoalWeight (sys, b);
+	  w = goalWeight (sys, b, weigh);
 
 	  // Spacing between output
 	  if (switches.output == PROOF && best != NULL)
@@ -459,6 +599,24 @@ select_goal_masked (const System sys)
   return best;
 }
 
+//! Goal selection by the heuristic mask
+Binding
+select_goal_masked (const System sys)
+{
+  return select_goal_lightest (sys, computeGoalWeight);
+}
+
+//! Goal selection by the feature weights file
+/**
+ * The weights are read by loadFeatureWeights() when the switches are
+ * processed.
+ */
+Binding
+select_goal_weights (const System sys)
+{
+  return select_goal_lightest (sys, computeFeatureWeight);
+}
+
 //! Goal selection special case -1: random
 /**
  * Simply picks an open goal randomly. Has to be careful to skip singular stuff etc.
@@ -496,10 +654,47 @@ select_goal_random (const System sys)
     }
 }
 
+//! Goal selection heuristics that can be chosen by name
+static struct goalselector goalselectors[] = {
+  {"masked", select_goal_masked},
+  {"random", select_goal_random},
+  {"weights", select_goal_weights},
+  {NULL, NULL}
+};
+
+//! Find a goal selection heuristic by name
+/**
+ * Called when the switches are processed, so that the search itself does
+ * not need to look up the name. Exits with an error for unknown names.
+ */
+const struct goalselector *
+goalSelector (const char *name)
+{
+  const struct goalselector *gs;
+
+  for (gs = goalselectors; gs->name != NULL; gs++)
+    {
+      if (strcmp (gs->name, name) == 0)
+	{
+	  return gs;
+	}
+    }
+  error ("Unknown goal selection heuristic '%s'.", name);
+  return NULL;
+}
+
 //! Goal selection function, generic
+/**
+ * A heuristic chosen by name takes precedence over the numeric
+ * --heuristic setting.
+ */
 Binding
 select_goal (const System sys)
 {
+  if (switches.goalSelect != NULL)
+    {
+      return switches.goalSelect->select (sys);
+    }
   if (switches.heuristic >= 0)
     {
       // Masked
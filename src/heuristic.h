@@ -23,6 +23,15 @@
 #include "system.h"
 #include "binding.h"
 
+//! A goal selection heuristic that can be chosen by name
+struct goalselector
+{
+  char *name;			//!< Name for --heuristic=<name>
+  Binding (*select) (const System sys);	//!< Selects the next goal, or NULL
+};
+
 Binding select_goal (const System sys);
+const struct goalselector *goalSelector (const char *name);
+void loadFeatureWeights (char *filename);
 
 #endif
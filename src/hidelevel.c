@@ -24,13 +24,40 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include "hidelevel.h"
 #include "system.h"
 #include "debug.h"
+#include "error.h"
 
 extern Term TERM_Hidden;
 
+//! Memo entry for the hidelevel results of a goal term
+/**
+ * The results only depend on the structure of the instantiated goal term,
+ * in which open variables are just leaves. The key is a frozen copy of that
+ * structure: it is copied down to the leaves, so neither later
+ * substitutions nor destroyed runs change it. It is allocated with malloc,
+ * to be independent of the lifetime of the term nodes.
+ */
+struct hidelevelmemo
+{
+  Term key;			//!< Frozen goal term, or NULL for a free slot
+  unsigned int hash;		//!< termHash() of the goal term
+  unsigned int flag;		//!< Result of hidelevelFlag()
+  int impossible;		//!< Result of hidelevelImpossible()
+};
+
+//! Maximum number of memo slots; a full memo is flushed
+#define HIDELEVELMEMO_MAX	65536
+
+static struct hidelevelmemo *memo = NULL;	//!< Open addressing table
+static unsigned int memosize = 0;	//!< Number of slots
+static unsigned int memocount = 0;	//!< Number of used slots
+static System memosys = NULL;	//!< System the memo was built for
+static Hiddenterm memohidden = NULL;	//!< Hidden terms the memo was built for
+
 //! hide level within protocol
 unsigned int
 protocolHidelevel (const System sys, const Term t)
@@ -93,12 +120,74 @@ knowledgeHidelevel (const System sys, const Term t)
   return minlevel;
 }
 
+//! Empty the memo.
+static void
+memoFlush (void)
+{
+  unsigned int i;
+
+  for (i = 0; i < memosize; i++)
+    {
+      if (memo[i].key != NULL)
+	{
+	  termFrozenDelete (memo[i].key);
+	  memo[i].key = NULL;
+	}
+    }
+  memocount = 0;
+}
+
+//! Double the size of the memo.
+static void
+memoGrow (void)
+{
+  struct hidelevelmemo *old;
+  unsigned int oldsize;
+  unsigned int i;
+
+  old = memo;
+  oldsize = memosize;
+  memosize = (oldsize == 0 ? 1024 : 2 * oldsize);
+  memo = (struct hidelevelmemo *) calloc (memosize,
+					   sizeof (struct hidelevelmemo));
+  if (memo == NULL)
+    {
+      error ("Out of memory for the hidelevel memo.");
+    }
+  for (i = 0; i < oldsize; i++)
+    {
+      if (old[i].key != NULL)
+	{
+	  unsigned int j;
+
+	  j = old[i].hash & (memosize - 1);
+	  while (memo[j].key != NULL)
+	    j = (j + 1) & (memosize - 1);
+	  memo[j] = old[i];
+	}
+    }
+  free (old);
+}
+
+//! Release the memo.
+void
+hidelevelDone (void)
+{
+  memoFlush ();
+  free (memo);
+  memo = NULL;
+  memosize = 0;
+  memosys = NULL;
+  memohidden = NULL;
+}
+
 //! Check hide levels
 void
 hidelevelCompute (const System sys)
 {
   Termlist tl;
 
+  memoFlush ();
   sys->hidden = NULL;
   tl = sys->globalconstants;
 
@@ -217,10 +306,79 @@ iterate_interesting (const System sys, const Term goalterm, int (*func) ())
   return true;
 }
 
+//! Find the memo entry for a goal term, computing it if needed.
+/**
+ * Both hidelevelImpossible() and hidelevelFlag() are answered from one
+ * iteration over the interesting terms.
+ *
+ *@return The entry, or NULL for an empty goal term.
+ */
+static struct hidelevelmemo *
+hidelevelMemo (const System sys, const Term goalterm)
+{
+  struct hidelevelmemo *e;
+  unsigned int h;
+  unsigned int i;
+
+  int both (unsigned int l, unsigned int lmin, unsigned int lprot,
+	    unsigned int lknow)
+  {
+    if (l < lmin)
+      {
+	// impossible, which also settles the flag
+	e->impossible = true;
+	e->flag = HLFLAG_NONE;
+	return false;
+      }
+    e->flag = e->flag | hidelevelParamFlag (l, lmin, lprot, lknow);
+    return true;
+  }
+
+  if (deVar (goalterm) == NULL)
+    {
+      return NULL;
+    }
+  if (sys != memosys || sys->hidden != memohidden)
+    {
+      memoFlush ();
+      memosys = sys;
+      memohidden = sys->hidden;
+    }
+  if (2 * (memocount + 1) > memosize)
+    {
+      if (memosize >= HIDELEVELMEMO_MAX)
+	memoFlush ();
+      else
+	memoGrow ();
+    }
+
+  h = termHash (goalterm);
+  i = h & (memosize - 1);
+  while (memo[i].key != NULL)
+    {
+      if (memo[i].hash == h && isTermFrozenEqual (memo[i].key, goalterm))
+	{
+	  return &(memo[i]);
+	}
+      i = (i + 1) & (memosize - 1);
+    }
+
+  e = &(memo[i]);
+  e->flag = HLFLAG_BOTH;
+  e->impossible = false;
+  iterate_interesting (sys, goalterm, both);
+  e->key = termFreeze (goalterm);
+  e->hash = h;
+  memocount++;
+  return e;
+}
+
 //! Determine whether a goal is impossible to satisfy because of the hidelevel lemma.
 int
 hidelevelImpossible (const System sys, const Term goalterm)
 {
+  struct hidelevelmemo *e;
+
   int possible (unsigned int l, unsigned int lmin, unsigned int lprot,
 		unsigned int lknow)
   {
@@ -232,6 +390,11 @@ hidelevelImpossible (const System sys, const Term goalterm)
     return true;
   }
 
+  e = hidelevelMemo (sys, goalterm);
+  if (e != NULL)
+    {
+      return e->impossible;
+    }
   return !iterate_interesting (sys, goalterm, possible);
 }
 
@@ -239,6 +402,7 @@ hidelevelImpossible (const System sys, const Term goalterm)
 unsigned int
 hidelevelFlag (const System sys, const Term goalterm)
 {
+  struct hidelevelmemo *e;
   unsigned int flag;
 
   int getflag (unsigned int l, unsigned int lmin, unsigned int lprot,
@@ -256,6 +420,11 @@ hidelevelFlag (const System sys, const Term goalterm)
     return true;
   }
 
+  e = hidelevelMemo (sys, goalterm);
+  if (e != NULL)
+    {
+      return e->flag;
+    }
   flag = HLFLAG_BOTH;
   iterate_interesting (sys, goalterm, getflag);
   return flag;
@@ -41,5 +41,6 @@
 void hidelevelCompute (const System sys);
 int hidelevelImpossible (const System sys, const Term goalterm);
 unsigned int hidelevelFlag (const System sys, const Term goalterm);
+void hidelevelDone (void);
 
 #endif
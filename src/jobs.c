@@ -0,0 +1,856 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *@file jobs.c
+ *
+ * Parallel verification of independent claims.
+ *
+ * With --jobs=N, each relevant claim is verified in its own forked worker
+ * process. After compilation and preprocessing the system is complete, so a
+ * fork gives every worker a private copy of the System, its run arrays, the
+ * binding list and the dependency graph stack, without sharing anything
+ * with the other workers. At most N workers are alive at the same time.
+ *
+ * Each worker writes its output (claim report, XML claim block, attacks) to
+ * two temporary files that stand in for stdout and stderr, and stores its
+ * claim counters in a result record. The parent copies the blocks to its own
+ * streams in claim order, so the output is the same as for a sequential run,
+ * except for the attack identifiers, which are taken from a range that is
+ * reserved per claim to keep them unique.
+ *
+ * With --split-depth=D, the proof tree of a single claim is split as well:
+ * when the search reaches an alternative at proof depth at most D and a job
+ * slot is free, the alternative is forked off as a task, which explores it
+ * on a snapshot of the semitrace, while the parent continues with the next
+ * alternative. Free slots are tokens in a pipe (as in the make jobserver),
+ * so any process of the tree can pick up work as soon as another finishes.
+ * Tasks are merged back into their parent at the end of the claim. If a
+ * task ends the search (e.g. because enough attacks were found), it raises
+ * a flag that is shared by all processes of the claim, which then stop
+ * exploring as well. The job slots are all used for the proof tree, so with
+ * --split-depth the claims themselves are verified one at a time.
+ *
+ * With --portfolio=N, a single claim test is raced by N processes that use
+ * different goal selection heuristics and attack pruning methods. The first
+ * one to reach a decisive answer (an attack, or a complete proof) wins, and
+ * the others are killed. Only the output and the counters of the winner are
+ * kept.
+ *
+ * Note that the time limit (--timer) applies to each process separately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FORWINDOWS
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+
+#include "system.h"
+#include "claim.h"
+#include "arachne.h"
+#include "switches.h"
+#include "tempfile.h"
+#include "error.h"
+#include "jobs.h"
+#include "symbol.h"
+
+//! Size of the range of attack identifiers reserved for a single claim or task.
+#define ATTACKID_STRIDE	1048576
+
+//! Interval in microseconds at which running workers are polled.
+#define JOB_POLL	2000
+
+extern int attack_length;
+extern int attack_leastcost;
+
+//! Claim results that a worker passes back to the parent.
+struct jobresult
+{
+  states_t count;
+  states_t failed;
+  states_t states;
+  int complete;
+  int timebound;
+  int warnings;
+  states_t sysstates;
+  states_t sysclaims;
+  states_t sysfailed;
+  int attackid;
+  int attack_length;
+  int attack_leastcost;
+  int proceed;			//!< False iff the search was ended
+};
+
+//! Bookkeeping for a single claim job.
+struct job
+{
+  Claimlist cl;			//!< The claim
+  FILE *out;			//!< Captured stdout of the worker
+  FILE *err;			//!< Captured stderr of the worker
+  int pid;			//!< Process id, or 0 if not (or no longer) running
+  int done;			//!< True iff the worker has finished
+  int status;			//!< Exit status of the worker
+};
+
+//! Bookkeeping for a task that explores part of the proof tree.
+struct task
+{
+  FILE *out;			//!< Captured stdout of the task
+  FILE *err;			//!< Captured stderr of the task
+  FILE *res;			//!< Result record of the task
+  int pid;			//!< Process id
+  struct jobresult base;	//!< Counters at the moment of the fork
+};
+
+//! Job slot tokens for tasks: read end, write end.
+static int tokenpipe[2] = { -1, -1 };
+
+//! Tasks started by this process for the current claim.
+static struct task *tasks = NULL;
+static int tasks_count = 0;
+static int tasks_max = 0;
+
+//! If this process is a task, its result record.
+static FILE *task_result = NULL;
+
+//! Shared by all processes of a claim: true iff a task ended the search.
+static volatile int *task_stop = NULL;
+
+//! Goal selection and attack pruning settings raced by --portfolio
+struct racer
+{
+  int heuristic;		//!< Heuristic mask
+  int prune;			//!< Attack pruning method
+};
+
+//! The settings that race against the configured ones, in order of preference
+static const struct racer racers[] = {
+  {162, 2}, {546, 2}, {130, 2}, {674, 1}
+};
+
+//! Number of entries in racers[]
+#define RACERS	((int) (sizeof (racers) / sizeof (struct racer)))
+
+#ifndef FORWINDOWS
+
+//! Copy a captured stream to a real one, and close the captured one.
+static void
+jobCopyStream (FILE * from, FILE * to)
+{
+  char buffer[4096];
+  size_t n;
+
+  fflush (from);
+  fseek (from, 0, SEEK_SET);
+  while ((n = fread (buffer, 1, sizeof (buffer), from)) > 0)
+    {
+      fwrite (buffer, 1, n, to);
+    }
+  fclose (from);
+}
+
+//! Check the exit status of a finished worker or task.
+static void
+jobCheckStatus (const int status)
+{
+  if (!WIFEXITED (status))
+    {
+      error ("A verification process was terminated.");
+    }
+  if (WEXITSTATUS (status) != 0)
+    {
+      exit (WEXITSTATUS (status));
+    }
+}
+
+//! Collect the current counters of a claim and the system.
+static void
+jobResultGet (const System sys, const Claimlist cl, struct jobresult *res)
+{
+  res->count = cl->count;
+  res->failed = cl->failed;
+  res->states = cl->states;
+  res->complete = cl->complete;
+  res->timebound = cl->timebound;
+  res->warnings = cl->warnings;
+  res->sysstates = sys->states;
+  res->sysclaims = sys->claims;
+  res->sysfailed = sys->failed;
+  res->attackid = sys->attackid;
+  res->attack_length = attack_length;
+  res->attack_leastcost = attack_leastcost;
+  res->proceed = true;
+}
+
+//! Worker side: verify a single claim and report back.
+static void
+jobWorker (const System sys, struct job *j, FILE * results, const int slot,
+	   const int attackbase)
+{
+  struct jobresult res;
+
+  // Redirect the output to the capture files
+  if (dup2 (fileno (j->out), fileno (stdout)) < 0
+      || dup2 (fileno (j->err), fileno (stderr)) < 0)
+    {
+      _exit (EXIT_ERROR);
+    }
+  // Errors end this process, not the verification of the parent
+  error_jump = NULL;
+
+  sys->attackid = attackbase;
+  sys->current_claim = j->cl;
+  arachneClaim ();
+
+  jobResultGet (sys, j->cl, &res);
+  fflush (stdout);
+  fflush (stderr);
+  if (pwrite (fileno (results), &res, sizeof (res),
+	      (off_t) slot * sizeof (res)) != sizeof (res))
+    {
+      _exit (EXIT_ERROR);
+    }
+  _exit (0);
+}
+
+//! Wait for one of the workers to finish, and mark it as done.
+/**
+ * Only our own workers are waited for, by polling their process ids, so
+ * that other children of the process (e.g. of a host program that embeds
+ * the verifier) are left to their owner.
+ *
+ *@return The index of the finished worker.
+ */
+static int
+jobReap (struct job *jobs, const int njobs)
+{
+  int status;
+  int i;
+
+  for (;;)
+    {
+      int running;
+
+      running = false;
+      for (i = 0; i < njobs; i++)
+	{
+	  int pid;
+
+	  if (jobs[i].pid == 0)
+	    {
+	      continue;
+	    }
+	  running = true;
+	  pid = waitpid (jobs[i].pid, &status, WNOHANG);
+	  if (pid < 0)
+	    {
+	      error ("Waiting for a claim verification process failed.");
+	    }
+	  if (pid == jobs[i].pid)
+	    {
+	      jobs[i].pid = 0;
+	      jobs[i].done = true;
+	      jobs[i].status = status;
+	      return i;
+	    }
+	}
+      if (!running)
+	{
+	  error ("Waiting for a claim verification process, but none runs.");
+	}
+      usleep (JOB_POLL);
+    }
+}
+
+//! Parent side: merge the results of a finished worker into the system.
+static void
+jobMerge (const System sys, struct job *j, FILE * results, const int slot,
+	  const states_t basestates, const states_t baseclaims,
+	  const states_t basefailed)
+{
+  struct jobresult res;
+
+  // Output first, so any error message of the worker is shown
+  jobCopyStream (j->out, stdout);
+  jobCopyStream (j->err, stderr);
+  fflush (stdout);
+  fflush (stderr);
+
+  jobCheckStatus (j->status);
+  if (pread (fileno (results), &res, sizeof (res),
+	     (off_t) slot * sizeof (res)) != sizeof (res))
+    {
+      error ("Could not retrieve results for claim at line %i.",
+	     j->cl->lineno);
+    }
+
+  j->cl->count = res.count;
+  j->cl->failed = res.failed;
+  j->cl->states = res.states;
+  j->cl->complete = res.complete;
+  j->cl->timebound = res.timebound;
+  j->cl->warnings = res.warnings;
+
+  // The worker started from the parent counters, so add only its delta
+  sys->states += res.sysstates - basestates;
+  sys->claims += res.sysclaims - baseclaims;
+  sys->failed += res.sysfailed - basefailed;
+  if (res.attackid > sys->attackid)
+    {
+      sys->attackid = res.attackid;
+    }
+}
+
+//! Racer side: test a claim with other settings and report back.
+static void
+racerWorker (const System sys, struct job *j, FILE * results, const int slot,
+	     const int attackbase)
+{
+  struct jobresult res;
+
+  // Redirect the output to the capture files
+  if ((FILE *) globalStream == stdout)
+    {
+      if (dup2 (fileno (j->out), fileno (stdout)) < 0)
+	{
+	  _exit (EXIT_ERROR);
+	}
+    }
+  else
+    {
+      globalStream = (char *) j->out;
+    }
+  if (dup2 (fileno (j->err), fileno (stderr)) < 0)
+    {
+      _exit (EXIT_ERROR);
+    }
+  // Errors end this process, not the verification of the parent
+  error_jump = NULL;
+
+  switches.portfolio = 0;
+  switches.splitDepth = 0;
+  if (slot > 0)
+    {
+      switches.goalSelect = NULL;
+      switches.heuristic = racers[slot - 1].heuristic;
+      switches.prune = racers[slot - 1].prune;
+    }
+  sys->attackid = attackbase;
+  arachneClaimTest (j->cl);
+
+  jobResultGet (sys, j->cl, &res);
+  fflush (NULL);
+  if (pwrite (fileno (results), &res, sizeof (res),
+	      (off_t) slot * sizeof (res)) != sizeof (res))
+    {
+      _exit (EXIT_ERROR);
+    }
+  _exit (0);
+}
+
+//! Stop the racers that are still running, and drop their output.
+static void
+racersStop (struct job *jobs, const int n, const int winner)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (jobs[i].pid != 0)
+	{
+	  kill (jobs[i].pid, SIGKILL);
+	  waitpid (jobs[i].pid, NULL, 0);
+	  jobs[i].pid = 0;
+	}
+      if (i != winner)
+	{
+	  fclose (jobs[i].out);
+	  fclose (jobs[i].err);
+	}
+    }
+}
+
+#endif
+
+//! Test a single claim with a portfolio of heuristics in parallel.
+/**
+ * Called by arachneClaimTest() when --portfolio is set. The first racer
+ * uses the configured settings, the others take theirs from racers[]. The
+ * first racer that finds an attack or completes the proof wins; if none
+ * does (e.g. because of the bounds), the configured settings win.
+ */
+void
+arachneClaimPortfolio (const System sys, const Claimlist cl)
+{
+#ifdef FORWINDOWS
+  error ("Portfolio verification (--portfolio) is not supported on Windows.");
+#else
+  struct job *jobs;
+  struct jobresult base;
+  struct jobresult res;
+  FILE *results;
+  int n;
+  int i;
+  int running;
+  int winner;
+
+  n = switches.portfolio;
+  if (n > RACERS + 1)
+    {
+      n = RACERS + 1;
+    }
+  jobs = (struct job *) malloc (n * sizeof (struct job));
+  results = scyther_tempfile ();
+  jobResultGet (sys, cl, &base);
+
+  // Avoid duplicating buffered output in the racers
+  fflush (NULL);
+  for (i = 0; i < n; i++)
+    {
+      int pid;
+
+      jobs[i].cl = cl;
+      jobs[i].out = scyther_tempfile ();
+      jobs[i].err = scyther_tempfile ();
+      jobs[i].done = false;
+      jobs[i].status = 0;
+      pid = fork ();
+      if (pid < 0)
+	{
+	  error ("Could not start a portfolio process.");
+	}
+      if (pid == 0)
+	{
+	  racerWorker (sys, &(jobs[i]), results, i,
+		       base.attackid + i * ATTACKID_STRIDE);
+	}
+      jobs[i].pid = pid;
+    }
+
+  // Wait for a decisive answer; only the racers are reaped, so other
+  // children of a host process keep their exit status
+  winner = -1;
+  running = n;
+  while (winner < 0 && running > 0)
+    {
+      i = jobReap (jobs, n);
+      running--;
+      if (!WIFEXITED (jobs[i].status) || WEXITSTATUS (jobs[i].status) != 0)
+	{
+	  // Show why it failed
+	  racersStop (jobs, n, i);
+	  jobCopyStream (jobs[i].out, (FILE *) globalStream);
+	  jobCopyStream (jobs[i].err, stderr);
+	  fflush (NULL);
+	  jobCheckStatus (jobs[i].status);
+	}
+      if (pread (fileno (results), &res, sizeof (res),
+		 (off_t) i * sizeof (res)) != sizeof (res))
+	{
+	  error ("Could not retrieve portfolio results for claim at line %i.",
+		 cl->lineno);
+	}
+      if (res.failed > 0 || res.complete)
+	{
+	  winner = i;
+	}
+    }
+  if (winner < 0)
+    {
+      winner = 0;
+    }
+  racersStop (jobs, n, winner);
+  if (pread (fileno (results), &res, sizeof (res),
+	     (off_t) winner * sizeof (res)) != sizeof (res))
+    {
+      error ("Could not retrieve portfolio results for claim at line %i.",
+	     cl->lineno);
+    }
+  jobCopyStream (jobs[winner].out, (FILE *) globalStream);
+  jobCopyStream (jobs[winner].err, stderr);
+  fclose (results);
+  free (jobs);
+
+  // Take over the results of the winner
+  cl->count = res.count;
+  cl->failed = res.failed;
+  cl->states = res.states;
+  cl->complete = res.complete;
+  cl->timebound = res.timebound;
+  cl->warnings = res.warnings;
+  sys->states += res.sysstates - base.sysstates;
+  sys->claims += res.sysclaims - base.sysclaims;
+  sys->failed += res.sysfailed - base.sysfailed;
+  sys->attackid = res.attackid;
+  attack_length = res.attack_length;
+  attack_leastcost = res.attack_leastcost;
+#endif
+}
+
+//! Set up the job slots for splitting the proof tree.
+/**
+ * There are switches.jobs - 1 slots, as the process that forks a task also
+ * keeps on working.
+ */
+void
+tasksInit (void)
+{
+#ifndef FORWINDOWS
+  int i;
+
+  if (switches.splitDepth <= 0 || switches.jobs <= 1 || tokenpipe[0] >= 0)
+    {
+      return;
+    }
+  if (pipe (tokenpipe) != 0)
+    {
+      error ("Could not create the job slot pipe.");
+    }
+  for (i = 1; i < switches.jobs; i++)
+    {
+      if (write (tokenpipe[1], "+", 1) != 1)
+	{
+	  error ("Could not fill the job slot pipe.");
+	}
+    }
+  // Grabbing a slot should never block the search
+  fcntl (tokenpipe[0], F_SETFL, fcntl (tokenpipe[0], F_GETFL) | O_NONBLOCK);
+
+  task_stop = (volatile int *) mmap (NULL, sizeof (int),
+				     PROT_READ | PROT_WRITE,
+				     MAP_SHARED | MAP_ANON, -1, 0);
+  if (task_stop == (volatile int *) MAP_FAILED)
+    {
+      error ("Could not create the shared task stop flag.");
+    }
+  *task_stop = false;
+#endif
+}
+
+//! Check whether a task has ended the search for the current claim.
+int
+tasksStopped (void)
+{
+  return (task_stop != NULL && *task_stop);
+}
+
+//! Try to hand off an alternative of the proof tree to a new task.
+/**
+ * Only alternatives at a proof depth of at most switches.splitDepth are
+ * considered, and only if a job slot is free.
+ *
+ *@return TASK_NONE if the caller should explore the alternative itself,
+ * TASK_CHILD in the new task, which should explore the alternative and
+ * then call taskExit(), and TASK_PARENT in the process that handed it off.
+ */
+int
+taskFork (const System sys, const int depth)
+{
+#ifdef FORWINDOWS
+  return TASK_NONE;
+#else
+  struct task *t;
+  char token;
+  int pid;
+
+  if (tokenpipe[0] < 0 || switches.splitDepth <= 0
+      || depth > switches.splitDepth)
+    {
+      return TASK_NONE;
+    }
+  if (read (tokenpipe[0], &token, 1) != 1)
+    {
+      // No free slot (EAGAIN), so just do it ourselves
+      return TASK_NONE;
+    }
+
+  if (tasks_count >= tasks_max)
+    {
+      struct task *grown;
+
+      grown = (struct task *) realloc (tasks, (2 * tasks_max + 8) *
+				       sizeof (struct task));
+      if (grown == NULL)
+	{
+	  error ("Could not allocate the proof tree tasks.");
+	}
+      tasks = grown;
+      tasks_max = 2 * tasks_max + 8;
+    }
+  t = &(tasks[tasks_count]);
+  t->out = scyther_tempfile ();
+  t->err = scyther_tempfile ();
+  t->res = scyther_tempfile ();
+  jobResultGet (sys, sys->current_claim, &(t->base));
+
+  fflush (NULL);
+  pid = fork ();
+  if (pid < 0)
+    {
+      error ("Could not start a proof tree task.");
+    }
+  if (pid == 0)
+    {
+      // The task; its output goes to the capture files
+      if (dup2 (fileno (t->out), fileno (stdout)) < 0
+	  || dup2 (fileno (t->err), fileno (stderr)) < 0)
+	{
+	  _exit (EXIT_ERROR);
+	}
+      task_result = t->res;
+      // Tasks of the parent are not ours to merge
+      tasks_count = 0;
+      // Errors end this process, not the verification of the parent
+      error_jump = NULL;
+      return TASK_CHILD;
+    }
+  t->pid = pid;
+  tasks_count++;
+  // Reserve the attack identifiers of the task
+  sys->attackid += ATTACKID_STRIDE;
+  return TASK_PARENT;
+#endif
+}
+
+//! Wait for all tasks started by this process, and merge their results.
+/**
+ * Tasks are merged in the order in which they were started.
+ *
+ *@return False iff one of the tasks ended the search.
+ */
+int
+tasksWait (const System sys)
+{
+#ifdef FORWINDOWS
+  return true;
+#else
+  int proceed;
+  int i;
+
+  proceed = true;
+
+  for (i = 0; i < tasks_count; i++)
+    {
+      struct task *t;
+      struct jobresult res;
+      Claimlist cl;
+      int status;
+
+      t = &(tasks[i]);
+      if (waitpid (t->pid, &status, 0) != t->pid)
+	{
+	  error ("Waiting for a proof tree task failed.");
+	}
+      jobCopyStream (t->out, stdout);
+      jobCopyStream (t->err, stderr);
+      jobCheckStatus (status);
+      fflush (t->res);
+      fseek (t->res, 0, SEEK_SET);
+      if (fread (&res, sizeof (res), 1, t->res) != 1)
+	{
+	  error ("Could not retrieve the results of a proof tree task.");
+	}
+      fclose (t->res);
+
+      // Add what the task did after the fork
+      cl = sys->current_claim;
+      cl->count += res.count - t->base.count;
+      cl->failed += res.failed - t->base.failed;
+      cl->states += res.states - t->base.states;
+      cl->complete = cl->complete && res.complete;
+      cl->timebound = cl->timebound || res.timebound;
+      cl->warnings = cl->warnings || res.warnings;
+      sys->states += res.sysstates - t->base.sysstates;
+      sys->claims += res.sysclaims - t->base.sysclaims;
+      sys->failed += res.sysfailed - t->base.sysfailed;
+      if (res.attack_length < attack_length)
+	{
+	  attack_length = res.attack_length;
+	}
+      if (res.attack_leastcost < attack_leastcost)
+	{
+	  attack_leastcost = res.attack_leastcost;
+	}
+      proceed = proceed && res.proceed;
+    }
+  tasks_count = 0;
+  // The claim is done once the process that started it has merged all
+  if (task_result == NULL && task_stop != NULL)
+    {
+      *task_stop = false;
+    }
+  return proceed;
+#endif
+}
+
+//! End a task: report the results to the parent and exit.
+/**
+ * The flag is the result of the alternative that the task explored; if it
+ * is false, the search is ended for all processes of the claim.
+ */
+void
+taskExit (const System sys, const int flag)
+{
+#ifndef FORWINDOWS
+  struct jobresult res;
+  int proceed;
+
+  proceed = tasksWait (sys) && flag;
+  if (!proceed)
+    {
+      *task_stop = true;
+    }
+  jobResultGet (sys, sys->current_claim, &res);
+  res.proceed = proceed;
+  fflush (stdout);
+  fflush (stderr);
+  if (fwrite (&res, sizeof (res), 1, task_result) != 1
+      || fflush (task_result) != 0)
+    {
+      _exit (EXIT_ERROR);
+    }
+  // Free our job slot
+  if (write (tokenpipe[1], "+", 1) != 1)
+    {
+      _exit (EXIT_ERROR);
+    }
+  _exit (0);
+#endif
+}
+
+//! Verify all relevant claims using parallel worker processes.
+/**
+ * Counterpart of the claim loop in arachne(). Claims are handed out in list
+ * order to at most switches.jobs concurrent workers; the output of a claim
+ * is emitted as soon as all claims before it have been emitted.
+ *
+ *@return The number of claims that were verified.
+ */
+int
+arachneClaimsParallel (const System sys)
+{
+#ifdef FORWINDOWS
+  error ("Parallel claim verification (--jobs) is not supported on Windows.");
+  return 0;
+#else
+  struct job *jobs;
+  FILE *results;
+  Claimlist cl;
+  states_t basestates, baseclaims, basefailed;
+  int attackbase;
+  int njobs;
+  int running;
+  int next;
+  int emitted;
+
+  // Collect the claims that will produce a report
+  njobs = 0;
+  for (cl = sys->claimlist; cl != NULL; cl = cl->next)
+    {
+      if (isClaimRelevant (cl) && !isClaimSignal (cl))
+	njobs++;
+    }
+  if (njobs == 0)
+    {
+      return 0;
+    }
+  jobs = (struct job *) malloc (njobs * sizeof (struct job));
+  njobs = 0;
+  for (cl = sys->claimlist; cl != NULL; cl = cl->next)
+    {
+      if (isClaimRelevant (cl) && !isClaimSignal (cl))
+	{
+	  jobs[njobs].cl = cl;
+	  jobs[njobs].out = NULL;
+	  jobs[njobs].err = NULL;
+	  jobs[njobs].pid = 0;
+	  jobs[njobs].done = false;
+	  jobs[njobs].status = 0;
+	  njobs++;
+	}
+    }
+
+  results = scyther_tempfile ();
+  basestates = sys->states;
+  baseclaims = sys->claims;
+  basefailed = sys->failed;
+  attackbase = sys->attackid;
+
+  running = 0;
+  next = 0;
+  emitted = 0;
+  while (emitted < njobs)
+    {
+      // Start as many workers as allowed
+      while (next < njobs && running < switches.jobs)
+	{
+	  struct job *j;
+	  int pid;
+
+	  j = &(jobs[next]);
+	  j->out = scyther_tempfile ();
+	  j->err = scyther_tempfile ();
+
+	  // Avoid duplicating buffered output in the worker
+	  fflush (NULL);
+	  pid = fork ();
+	  if (pid < 0)
+	    {
+	      error ("Could not start a claim verification process.");
+	    }
+	  if (pid == 0)
+	    {
+	      jobWorker (sys, j, results, next,
+			 attackbase + next * ATTACKID_STRIDE);
+	    }
+	  j->pid = pid;
+	  running++;
+	  next++;
+	}
+
+      // Emit finished claims in order
+      while (emitted < next && jobs[emitted].done)
+	{
+	  jobMerge (sys, &(jobs[emitted]), results, emitted, basestates,
+		    baseclaims, basefailed);
+	  emitted++;
+	}
+
+      // Wait for a worker if we are not done yet
+      if (emitted < njobs)
+	{
+	  jobReap (jobs, njobs);
+	  running--;
+	}
+    }
+
+  fclose (results);
+  free (jobs);
+  return njobs;
+#endif
+}
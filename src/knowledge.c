@@ -22,6 +22,13 @@
  *\brief Procedures concerning knowledge structures.
  *
  * The main issue of this code is to maintain the minimal property of the knowledge set.
+ *
+ * Next to the lists, which define the order in which the set is reported,
+ * each knowledge set has a hash index: of the terms in the basic and
+ * encrypted lists, of the encrypted terms by their key, and of the inverse
+ * pairs. Only terms without variables are hashed, as the value of a
+ * variable changes during the search. Lookups fall back to scanning the
+ * lists when the set has terms with variables, as role knowledge often has.
  */
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,6 +39,375 @@
 #include "error.h"
 #include "specialterm.h"
 
+/*
+ * Hash index
+ */
+
+//! Minimal number of buckets of an index
+#define KNOWINDEX_MINSIZE	16
+
+//! Map from keys to their inverses, built from a list of inverse pairs
+struct invmap
+{
+  Termlist source;		//!< List of pairs the map was built from
+  Termlist *buckets;		//!< Per bucket: key, inverse, key, inverse, ...
+  int size;			//!< Number of buckets, a power of two
+  int open;			//!< True iff some pair has variables
+};
+
+//! Hash index of a knowledge set
+struct knowindex
+{
+  Termlist *terms;		//!< Terms of basic and encrypt without variables
+  Termlist *keyed;		//!< Terms of encrypt by their key, if it has no variables
+  int size;			//!< Number of buckets, a power of two
+  int count;			//!< Number of terms in terms
+  int open;			//!< Number of terms of basic and encrypt with variables
+  Termlist openkeyed;		//!< Terms of encrypt whose key has variables
+  struct invmap inverses;	//!< Map of knowledge::inversekeys
+  struct invmap functions;	//!< Map of knowledge::inversekeyfunctions
+};
+
+//! Allocate an array of empty buckets
+static Termlist *
+makeBuckets (const int size)
+{
+  Termlist *buckets;
+  int i;
+
+  buckets = (Termlist *) malloc (size * sizeof (Termlist));
+  if (buckets == NULL)
+    {
+      error ("Out of memory for the knowledge index.");
+    }
+  for (i = 0; i < size; i++)
+    {
+      buckets[i] = NULL;
+    }
+  return buckets;
+}
+
+//! Delete an array of buckets
+static void
+deleteBuckets (Termlist * buckets, const int size)
+{
+  int i;
+
+  if (buckets != NULL)
+    {
+      for (i = 0; i < size; i++)
+	{
+	  termlistDelete (buckets[i]);
+	}
+      free (buckets);
+    }
+}
+
+//! Remove a term, by pointer, from a bucket
+static void
+bucketRemove (Termlist * bucket, const Term t)
+{
+  Termlist tl;
+
+  for (tl = *bucket; tl != NULL; tl = tl->next)
+    {
+      if (tl->term == t)
+	{
+	  *bucket = termlistDelTerm (tl);
+	  return;
+	}
+    }
+}
+
+//! Insert a term of basic or encrypt into the index, without growing it
+static void
+knowIndexInsert (struct knowindex *ki, const Term t)
+{
+  int b;
+
+  if (isTermFixed (t))
+    {
+      b = termHash (t) & (ki->size - 1);
+      ki->terms[b] = termlistAdd (ki->terms[b], t);
+      ki->count++;
+    }
+  else
+    {
+      ki->open++;
+    }
+  if (realTermEncrypt (t))
+    {
+      if (isTermFixed (TermKey (t)))
+	{
+	  b = termHash (TermKey (t)) & (ki->size - 1);
+	  ki->keyed[b] = termlistAdd (ki->keyed[b], t);
+	}
+      else
+	{
+	  ki->openkeyed = termlistAdd (ki->openkeyed, t);
+	}
+    }
+}
+
+//! Rebuild the term index of a knowledge set from its lists
+static void
+knowIndexFill (const Knowledge know, const int size)
+{
+  struct knowindex *ki;
+  Termlist tl;
+
+  ki = know->index;
+  deleteBuckets (ki->terms, ki->size);
+  deleteBuckets (ki->keyed, ki->size);
+  termlistDelete (ki->openkeyed);
+  ki->terms = makeBuckets (size);
+  ki->keyed = makeBuckets (size);
+  ki->size = size;
+  ki->count = 0;
+  ki->open = 0;
+  ki->openkeyed = NULL;
+  for (tl = know->basic; tl != NULL; tl = tl->next)
+    {
+      knowIndexInsert (ki, tl->term);
+    }
+  for (tl = know->encrypt; tl != NULL; tl = tl->next)
+    {
+      knowIndexInsert (ki, tl->term);
+    }
+}
+
+//! Create the index of a knowledge set from its lists
+static void
+knowIndexCreate (const Knowledge know)
+{
+  struct knowindex *ki;
+  int size;
+
+  ki = (struct knowindex *) malloc (sizeof (struct knowindex));
+  if (ki == NULL)
+    {
+      error ("Out of memory for the knowledge index.");
+    }
+  ki->terms = NULL;
+  ki->keyed = NULL;
+  ki->size = 0;
+  ki->openkeyed = NULL;
+  ki->inverses.source = NULL;
+  ki->inverses.buckets = NULL;
+  ki->inverses.size = 0;
+  ki->inverses.open = 0;
+  ki->functions = ki->inverses;
+  know->index = ki;
+
+  size = KNOWINDEX_MINSIZE;
+  while (size < termlistLength (know->basic) + termlistLength (know->encrypt))
+    {
+      size = 2 * size;
+    }
+  knowIndexFill (know, size);
+}
+
+//! Delete the index of a knowledge set
+static void
+knowIndexDelete (const Knowledge know)
+{
+  struct knowindex *ki;
+
+  ki = know->index;
+  deleteBuckets (ki->terms, ki->size);
+  deleteBuckets (ki->keyed, ki->size);
+  termlistDelete (ki->openkeyed);
+  deleteBuckets (ki->inverses.buckets, ki->inverses.size);
+  deleteBuckets (ki->functions.buckets, ki->functions.size);
+  free (ki);
+  know->index = NULL;
+}
+
+//! Index a term that was just added to basic or encrypt
+static void
+knowIndexAdd (const Knowledge know, const Term t)
+{
+  struct knowindex *ki;
+
+  ki = know->index;
+  if (ki->count + ki->open >= ki->size)
+    {
+      // The lists already hold the term
+      knowIndexFill (know, 2 * ki->size);
+    }
+  else
+    {
+      knowIndexInsert (ki, t);
+    }
+}
+
+//! Unindex a term that is removed from encrypt
+static void
+knowIndexRemove (const Knowledge know, const Term t)
+{
+  struct knowindex *ki;
+
+  ki = know->index;
+  if (isTermFixed (t))
+    {
+      bucketRemove (&ki->terms[termHash (t) & (ki->size - 1)], t);
+      ki->count--;
+    }
+  else
+    {
+      ki->open--;
+    }
+  if (isTermFixed (TermKey (t)))
+    {
+      bucketRemove (&ki->keyed[termHash (TermKey (t)) & (ki->size - 1)], t);
+    }
+  else
+    {
+      bucketRemove (&ki->openkeyed, t);
+    }
+}
+
+//! Check whether a term equals an element of a list of the knowledge
+/**
+ *@param tl Either knowledge::basic or knowledge::encrypt, for when the
+ *          index cannot decide.
+ */
+static int
+knowIndexMember (const Knowledge know, const Termlist tl, const Term t)
+{
+  struct knowindex *ki;
+
+  ki = know->index;
+  if (ki->count > 0)
+    {
+      Termlist scan;
+
+      for (scan = ki->terms[termHash (t) & (ki->size - 1)]; scan != NULL;
+	   scan = scan->next)
+	{
+	  if (isTermEqual (scan->term, t))
+	    return 1;
+	}
+    }
+  if (ki->open > 0)
+    {
+      return inTermlist (tl, t);
+    }
+  return 0;
+}
+
+//! Check whether some term of encrypt may have a given key
+static int
+knowIndexKeyed (const Knowledge know, const Term key)
+{
+  struct knowindex *ki;
+  Termlist scan;
+
+  ki = know->index;
+  if (ki->openkeyed != NULL)
+    return 1;
+  for (scan = ki->keyed[termHash (key) & (ki->size - 1)]; scan != NULL;
+       scan = scan->next)
+    {
+      if (isTermEqual (TermKey (scan->term), key))
+	return 1;
+    }
+  return 0;
+}
+
+//! Add a key and its inverse to a map, unless the key is already there
+static void
+invmapInsert (struct invmap *m, const Term key, const Term inverse)
+{
+  Termlist tl;
+  int b;
+
+  b = termHash (key) & (m->size - 1);
+  for (tl = m->buckets[b]; tl != NULL; tl = tl->next->next)
+    {
+      if (isTermEqual (tl->term, key))
+	return;
+    }
+  m->buckets[b] = termlistAdd (termlistAdd (m->buckets[b], inverse), key);
+}
+
+//! Build a map from a list of inverse pairs
+static void
+invmapBuild (struct invmap *m, const Termlist pairs)
+{
+  Termlist tl;
+  int size;
+
+  deleteBuckets (m->buckets, m->size);
+  m->source = pairs;
+  m->buckets = NULL;
+  m->size = 0;
+  m->open = 0;
+  if (pairs == NULL)
+    return;
+  for (tl = pairs; tl != NULL; tl = tl->next)
+    {
+      if (!isTermFixed (tl->term))
+	{
+	  m->open = 1;
+	  return;
+	}
+    }
+  size = KNOWINDEX_MINSIZE;
+  while (size < termlistLength (pairs))
+    {
+      size = 2 * size;
+    }
+  m->buckets = makeBuckets (size);
+  m->size = size;
+  // Earlier pairs take precedence, as when scanning the list
+  for (tl = pairs; tl != NULL && tl->next != NULL; tl = tl->next->next)
+    {
+      invmapInsert (m, tl->term, tl->next->term);
+      invmapInsert (m, tl->next->term, tl->term);
+    }
+}
+
+//! Find the inverse of a key in a list of inverse pairs
+/**
+ * The map is rebuilt when the list has changed. As pairs are only added at
+ * the front, this is detected by the head of the list.
+ *@return The inverse in the list, or NULL if there is none.
+ */
+static Term
+invmapFind (struct invmap *m, const Termlist pairs, const Term key)
+{
+  Termlist tl;
+
+  if (m->source != pairs)
+    {
+      invmapBuild (m, pairs);
+    }
+  if (m->open)
+    {
+      /* scan the list */
+      tl = pairs;
+      while (tl != NULL && tl->next != NULL)
+	{
+	  if (isTermEqual (key, tl->term))
+	    return tl->next->term;
+	  if (isTermEqual (key, tl->next->term))
+	    return tl->term;
+	  tl = tl->next->next;
+	}
+      return NULL;
+    }
+  if (m->buckets == NULL)
+    return NULL;
+  for (tl = m->buckets[termHash (key) & (m->size - 1)]; tl != NULL;
+       tl = tl->next->next)
+    {
+      if (isTermEqual (tl->term, key))
+	return tl->next->term;
+    }
+  return NULL;
+}
+
 /*
  * Knowledge stuff
  */
@@ -76,6 +452,7 @@ emptyKnowledge ()
   know->inversekeyfunctions = NULL;
   know->vars = NULL;
   know->publicfunctions = NULL;
+  knowIndexCreate (know);
   return know;
 }
 
@@ -83,7 +460,7 @@ emptyKnowledge ()
 /**
  * Makes copies using termlistShallow() of knowledge::basic, knowledge::encrypt and 
  * knowledge::vars.
- * For the inverses, only the pointer is copied.
+ * For the inverses, only the pointer is copied. The copy gets its own index.
  *@param know The knowledge structure to be copied.
  *@return A pointer to a new memory struct.
  *\sa termlistShallow(), knowledgeDelete()
@@ -105,6 +482,7 @@ knowledgeDuplicate (Knowledge know)
   newknow->inversekeys = know->inversekeys;
   newknow->inversekeyfunctions = know->inversekeyfunctions;
   newknow->publicfunctions = termlistShallow (know->publicfunctions);
+  knowIndexCreate (newknow);
   return newknow;
 }
 
@@ -118,6 +496,7 @@ knowledgeDelete (Knowledge know)
 {
   if (know != NULL)
     {
+      knowIndexDelete (know);
       termlistDelete (know->basic);
       termlistDelete (know->encrypt);
       termlistDelete (know->vars);
@@ -137,6 +516,7 @@ knowledgeDestroy (Knowledge know)
 {
   if (know != NULL)
     {
+      knowIndexDelete (know);
       termlistDestroy (know->basic);
       termlistDestroy (know->encrypt);
       termlistDestroy (know->vars);
@@ -186,6 +566,7 @@ knowledgeAddTerm (Knowledge know, Term term)
   if (isTermLeaf (term))
     {
       know->basic = termlistAdd (know->basic, term);
+      knowIndexAdd (know, term);
     }
   if (term->type == ENCRYPT)
     {
@@ -198,12 +579,14 @@ knowledgeAddTerm (Knowledge know, Term term)
 	    {
 	      /* we know the op now, but not the key, so add it anyway */
 	      know->encrypt = termlistAdd (know->encrypt, term);
+	      knowIndexAdd (know, term);
 	    }
 	}
       else
 	{
 	  /* we cannot decrypt it, and from the initial test we know we could not construct it */
 	  know->encrypt = termlistAdd (know->encrypt, term);
+	  knowIndexAdd (know, term);
 	}
       termDelete (invkey);
     }
@@ -223,11 +606,18 @@ knowledgeSimplify (Knowledge know, Term key)
   Termlist scan = know->encrypt;
   Term invkey = inverseKey (know, key);
 
+  /* usually nothing can be decrypted, which the index tells quickly */
+  if (!knowIndexKeyed (know, invkey))
+    {
+      termDelete (invkey);
+      return;
+    }
   while (scan != NULL)
     {
       if (isTermEqual (TermKey (scan->term), invkey))
 	{
 	  tldecrypts = termlistAdd (tldecrypts, TermOp (scan->term));
+	  knowIndexRemove (know, scan->term);
 	  know->encrypt = termlistDelTerm (scan);
 	  scan = know->encrypt;
 	}
@@ -295,11 +685,11 @@ inKnowledge (const Knowledge know, Term term)
   term = deVar (term);
   if (isTermLeaf (term))
     {
-      return inTermlist (know->basic, term);
+      return knowIndexMember (know, know->basic, term);
     }
   if (term->type == ENCRYPT)
     {
-      return inTermlist (know->encrypt, term) ||
+      return knowIndexMember (know, know->encrypt, term) ||
 	(inKnowledge (know, TermKey (term))
 	 && inKnowledge (know, TermOp (term)));
     }
@@ -388,7 +778,8 @@ knowledgeSet (const Knowledge know)
 int
 inKnowledgeSet (const Knowledge know, Term t)
 {
-  return (inTermlist (know->basic, t) || inTermlist (know->encrypt, t));
+  return (knowIndexMember (know, know->basic, t) ||
+	  knowIndexMember (know, know->encrypt, t));
 }
 
 //! check whether any substitutions where made in a knowledge set.
@@ -443,6 +834,7 @@ Term
 inverseKey (Knowledge know, Term key)
 {
   Term f;
+  Term inv;
 
   key = deVar (key);
 
@@ -450,8 +842,6 @@ inverseKey (Knowledge know, Term key)
   f = getTermFunction (key);
   if (f != NULL)
     {
-      Termlist tl;
-
       Term funKey (Term orig, Term f)
       {
 	/* in: f'{op}, f
@@ -460,31 +850,17 @@ inverseKey (Knowledge know, Term key)
 			      termDuplicate (f));
       }
 
-      tl = know->inversekeyfunctions;
-      while (tl != NULL && tl->next != NULL)
-	{
-	  if (isTermEqual (TermKey (key), tl->term))
-	    return funKey (key, tl->next->term);
-	  if (isTermEqual (TermKey (key), tl->next->term))
-	    return funKey (key, tl->term);
-	  tl = tl->next->next;
-	}
+      inv = invmapFind (&know->index->functions, know->inversekeyfunctions,
+			TermKey (key));
+      if (inv != NULL)
+	return funKey (key, inv);
     }
   else
     {
-      /* scanning for a direct inverse */
-      Termlist tl;
-
-      /* scan the list */
-      tl = know->inversekeys;
-      while (tl != NULL && tl->next != NULL)
-	{
-	  if (isTermEqual (key, tl->term))
-	    return termDuplicate (tl->next->term);
-	  if (isTermEqual (key, tl->next->term))
-	    return termDuplicate (tl->term);
-	  tl = tl->next->next;
-	}
+      /* direct inverse? */
+      inv = invmapFind (&know->index->inverses, know->inversekeys, key);
+      if (inv != NULL)
+	return termDuplicate (inv);
     }
   return termDuplicate (key);	/* defaults to symmetrical */
 }
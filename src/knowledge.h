@@ -23,6 +23,8 @@
 #include "term.h"
 #include "termlist.h"
 
+struct knowindex;
+
 //! Knowledge structure.
 /**
  * Contains a miminal representation of a knowledge set.
@@ -46,6 +48,8 @@ struct knowledge
   Termlist vars;		// special: denotes unsubstituted variables
   //! A list of hash functions
   Termlist publicfunctions;
+  //! Hash index of the lists above, private to knowledge.c
+  struct knowindex *index;
 };
 
 //! Shorthand for knowledge pointer.
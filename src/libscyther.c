@@ -0,0 +1,597 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *@file libscyther.c
+ *
+ * In-process verification interface.
+ *
+ * The command-line tool parses and compiles a protocol description, verifies
+ * all its claims, and exits. This module offers the same steps as separate
+ * calls, so that a host program (e.g. the Python interface) can load a
+ * description once, and then verify its claims one by one, without starting
+ * a process and re-parsing the input for every claim. It is only part of the
+ * shared library build, where it takes the place of main.c.
+ *
+ * The engine keeps its state in process globals, so only one description can
+ * be loaded at a time, and there is only one active verification per
+ * process. A call that is made while another call is still running (from
+ * another thread, or from within an output callback) is rejected: it returns
+ * false, or -1 for scytherClaimCount(), and scytherUnload() does nothing.
+ * After loading, the engine state is stored in a verifier context, which is
+ * loaded again before each verification, so that the switches given for one
+ * claim do not carry over to the next.
+ *
+ * Errors do not terminate the host process: error() jumps back to the entry
+ * point, which then returns false. An error during the search itself leaves
+ * the engine in an undefined state; after that, only scytherUnload() can be
+ * used.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include "system.h"
+#include "symbol.h"
+#include "tac.h"
+#include "compiler.h"
+#include "switches.h"
+#include "specialterm.h"
+#include "color.h"
+#include "error.h"
+#include "claim.h"
+#include "arachne.h"
+#include "xmlout.h"
+#include "context.h"
+#include "tempfile.h"
+#include "libscyther.h"
+
+//! The global system state pointer
+System sys;
+
+//! Pointer to the tac node container
+extern struct tacnode *spdltac;
+
+void scanner_start (FILE * input);
+void scanner_cleanup (void);
+void strings_cleanup (void);
+void parser_cleanup (void);
+int yyparse (void);
+
+static int loaded = false;	//!< Modules are initialised
+static int started = false;	//!< arachneInit() has been called
+static int broken = false;	//!< An error occurred during a search
+static VerifierContext loadedContext = NULL;	//!< Engine state after loading
+static volatile int busy = false;	//!< A library call is running
+
+//! Claim the engine for a library call
+/**
+ *@returns False if another call is still running.
+ */
+static int
+enter (void)
+{
+  return !__sync_lock_test_and_set (&busy, true);
+}
+
+//! Release the engine after a library call
+static void
+leave (void)
+{
+  __sync_lock_release (&busy);
+}
+
+//! Read the contents of a stream into a fresh string
+static char *
+streamToString (FILE * fp)
+{
+  long size;
+  char *buffer;
+
+  fflush (fp);
+  size = ftell (fp);
+  buffer = (char *) malloc (size + 1);
+  rewind (fp);
+  size = fread (buffer, 1, size, fp);
+  buffer[size] = '\0';
+  return buffer;
+}
+
+//! Capture the output of a print function in a fresh string
+static char *
+printToString (void (*print) (void))
+{
+  FILE *fp;
+  char *stream;
+  int err;
+  char *result;
+
+  fp = scyther_tempfile ();
+  stream = globalStream;
+  err = globalError;
+  globalStream = (char *) fp;
+  globalError = 0;
+  print ();
+  globalStream = stream;
+  globalError = err;
+  result = streamToString (fp);
+  fclose (fp);
+  return result;
+}
+
+//! Print a term to a fresh string
+static char *
+termToString (const Term t)
+{
+  void print (void)
+  {
+    termPrint (t);
+  }
+
+  return printToString (print);
+}
+
+//! Find the n-th claim (counting from 0) that is not a signal
+static Claimlist
+claimFind (int n)
+{
+  Claimlist cl;
+
+  if (!loaded || !started)
+    {
+      return NULL;
+    }
+  for (cl = sys->claimlist; cl != NULL; cl = cl->next)
+    {
+      if (!isClaimSignal (cl))
+	{
+	  if (n == 0)
+	    {
+	      return cl;
+	    }
+	  n--;
+	}
+    }
+  return NULL;
+}
+
+//! Fill a result structure for a claim
+/**
+ * If the claim was not verified, only the identification is filled in.
+ */
+static void
+resultFill (const Claimlist cl, struct scytherresult *result,
+	    const int verified)
+{
+  Term pname;
+  Term rname;
+
+  // The label, without the protocol and role names (as in claimStatusReport)
+  void print_label (void)
+  {
+    Termlist labellist;
+    Termlist tl;
+
+    labellist = tuple_to_termlist (cl->label);
+    tl = labellist;
+    while (tl != NULL)
+      {
+	if (isTermEqual (tl->term, pname) || isTermEqual (tl->term, rname))
+	  {
+	    tl = termlistDelTerm (tl);
+	    labellist = tl;
+	  }
+	else
+	  {
+	    tl = tl->next;
+	  }
+      }
+    if (labellist == NULL)
+      {
+	eprintf ("?");
+      }
+    for (tl = labellist; tl != NULL; tl = tl->next)
+      {
+	termPrint (tl->term);
+	if (tl->next != NULL)
+	  {
+	    eprintf (",");
+	  }
+      }
+    termlistDelete (labellist);
+  }
+
+  pname = ((Protocol) cl->protocol)->nameterm;
+  rname = cl->rolename;
+
+  result->protocol = termToString (pname);
+  result->role = termToString (rname);
+  result->type = termToString (cl->type);
+  result->label = printToString (print_label);
+  if (cl->parameter != NULL)
+    {
+      result->parameter = termToString (cl->parameter);
+    }
+  else
+    {
+      result->parameter = NULL;
+    }
+  result->lineno = cl->lineno;
+  result->output = NULL;
+
+  if (verified)
+    {
+      int existState;
+      int isAttack;
+
+      // Fail == ( existState xor isAttack ), see printOkFail()
+      existState = (cl->count > 0 && cl->failed > 0);
+      isAttack = !isTermEqual (cl->type, CLAIM_Reachable);
+      if (existState != isAttack)
+	{
+	  result->status = SCYTHER_OK;
+	}
+      else
+	{
+	  result->status = SCYTHER_FAIL;
+	}
+      result->complete = cl->complete;
+      result->timebound = cl->timebound;
+      result->failed = cl->failed;
+      result->count = cl->count;
+      result->states = cl->states;
+    }
+  else
+    {
+      result->status = SCYTHER_UNVERIFIED;
+      result->complete = false;
+      result->timebound = false;
+      result->failed = 0;
+      result->count = 0;
+      result->states = 0;
+    }
+}
+
+//! Initialise the modules, as main() does before parsing
+static void
+libraryInit (const char *flags)
+{
+  termsInit ();
+  termmapsInit ();
+  termlistsInit ();
+  knowledgeInit ();
+  symbolsInit ();
+  tacInit ();
+
+  // No command line: only SCYTHERFLAGS and the flags given here
+  switchesInit (0, NULL);
+  process_switch_buffer ((char *) flags);
+
+  colorInit ();
+  sys = systemInit ();
+  sys->know = emptyKnowledge ();
+  compilerInit (sys);
+  loaded = true;
+}
+
+//! Unload the protocol description, and clean up all memory, as main() does
+static void
+unload (void)
+{
+  if (!loaded)
+    {
+      return;
+    }
+  if (loadedContext != NULL)
+    {
+      if (!broken)
+	{
+	  contextLoad (loadedContext);
+	}
+      contextDestroy (loadedContext);
+      loadedContext = NULL;
+    }
+  if (started)
+    {
+      arachneDone ();
+    }
+  knowledgeDestroy (sys->know);
+  systemDone (sys);
+  colorDone ();
+  switchesDone ();
+  compilerDone ();
+  parser_cleanup ();
+
+  tacDone ();
+  symbolsDone ();
+  knowledgeDone ();
+  termlistsDone ();
+  listsDone ();
+  termmapsDone ();
+  termsDone ();
+  strings_cleanup ();
+
+  loaded = false;
+  started = false;
+  broken = false;
+}
+
+//! Parse and compile a protocol description from a stream
+static int
+loadStream (FILE * fp, const char *flags)
+{
+  jmp_buf env;
+
+  if (setjmp (env))
+    {
+      error_jump = NULL;
+      unload ();
+      return false;
+    }
+  error_jump = &env;
+
+  libraryInit (flags);
+
+  scanner_start (fp);
+  yyparse ();
+  compile (spdltac, 0);
+  scanner_cleanup ();
+
+  systemStart (sys);
+  sys->traceKnow[0] = sys->know;	// store initial knowledge
+  arachneInit (sys);
+  started = true;
+
+  systemReset (sys);
+  systemRuns (sys);
+  arachneSetup ();
+  loadedContext = contextCreate ();
+
+  error_jump = NULL;
+  return true;
+}
+
+//! Load a protocol description from a string
+/**
+ * Any previously loaded description is unloaded first. The flags are
+ * command-line switches (e.g. "--max-runs=3"), and apply to all claims.
+ *
+ *@returns True iff the description was parsed and compiled.
+ */
+int
+scytherLoad (const char *spdl, const char *flags)
+{
+  FILE *fp;
+  int result;
+
+  if (!enter ())
+    {
+      return false;
+    }
+  unload ();
+  fp = scyther_tempfile ();
+  if (fp == NULL)
+    {
+      leave ();
+      return false;
+    }
+  fputs (spdl, fp);
+  rewind (fp);
+  result = loadStream (fp, flags);
+  fclose (fp);
+  leave ();
+  return result;
+}
+
+//! Load a protocol description from a file
+/**
+ * The file is searched for as on the command line, i.e. also in SCYTHERDIR.
+ * Otherwise the same as scytherLoad().
+ */
+int
+scytherLoadFile (const char *filename, const char *flags)
+{
+  FILE *fp;
+  int result;
+
+  if (!enter ())
+    {
+      return false;
+    }
+  unload ();
+  fp = openFileSearch ((char *) filename, NULL);
+  if (fp == NULL)
+    {
+      leave ();
+      return false;
+    }
+  result = loadStream (fp, flags);
+  fclose (fp);
+  leave ();
+  return result;
+}
+
+//! Number of claims of the loaded description
+/**
+ * Claims are numbered from 0 in the order of the description; signal claims
+ * such as Running and SID are not counted.
+ *
+ *@returns The number of claims, or -1 if another call is running.
+ */
+int
+scytherClaimCount (void)
+{
+  int n;
+
+  if (!enter ())
+    {
+      return -1;
+    }
+  n = 0;
+  while (claimFind (n) != NULL)
+    {
+      n++;
+    }
+  leave ();
+  return n;
+}
+
+//! Describe a claim without verifying it
+/**
+ *@returns False if there is no such claim.
+ */
+int
+scytherClaimInfo (const int n, struct scytherresult *result)
+{
+  Claimlist cl;
+
+  if (!enter ())
+    {
+      return false;
+    }
+  cl = claimFind (n);
+  if (cl == NULL || broken)
+    {
+      leave ();
+      return false;
+    }
+  resultFill (cl, result, false);
+  leave ();
+  return true;
+}
+
+//! Verify a claim
+/**
+ * The flags are command-line switches that apply to this claim only, e.g.
+ * "--xml-output" or "--timer=10". Whatever the verifier outputs for the
+ * claim, such as attacks, ends up in result->output; with --xml-output this
+ * is a complete scyther XML document, as the command-line tool would give
+ * for this claim.
+ *
+ *@returns False if there is no such claim, if an error occurred, or if
+ * another call is running.
+ */
+int
+scytherVerify (const int n, const char *flags, struct scytherresult *result)
+{
+  jmp_buf env;
+  Claimlist cl;
+  FILE *capture;
+  volatile int searching;
+
+  if (!enter ())
+    {
+      return false;
+    }
+  cl = claimFind (n);
+  if (cl == NULL || broken)
+    {
+      leave ();
+      return false;
+    }
+  capture = scyther_tempfile ();
+  if (capture == NULL)
+    {
+      leave ();
+      return false;
+    }
+  contextLoad (loadedContext);
+  searching = false;
+  if (setjmp (env))
+    {
+      error_jump = NULL;
+      fclose (capture);
+      if (searching)
+	{
+	  broken = true;
+	}
+      else
+	{
+	  contextLoad (loadedContext);
+	}
+      leave ();
+      return false;
+    }
+  error_jump = &env;
+  process_switch_buffer ((char *) flags);
+
+  globalStream = (char *) capture;
+  globalError = 0;
+  cl->count = STATES0;
+  cl->failed = STATES0;
+  cl->states = STATES0;
+  cl->complete = false;
+  cl->timebound = false;
+  sys->current_claim = cl;
+
+  searching = true;
+  if (switches.xml)
+    {
+      xmlOutInit ();
+    }
+  // Some claims are always true!
+  if (!cl->alwaystrue)
+    {
+      arachneClaimTest (cl);
+    }
+  if (switches.xml)
+    {
+      xmlOutClaim (sys, cl);
+      xmlOutDone ();
+    }
+  error_jump = NULL;
+
+  contextLoad (loadedContext);
+  resultFill (cl, result, true);
+  result->output = streamToString (capture);
+  fclose (capture);
+  leave ();
+  return true;
+}
+
+//! Release the strings of a result structure
+void
+scytherResultFree (struct scytherresult *result)
+{
+  free (result->protocol);
+  free (result->role);
+  free (result->type);
+  free (result->label);
+  free (result->parameter);
+  free (result->output);
+  result->protocol = NULL;
+  result->role = NULL;
+  result->type = NULL;
+  result->label = NULL;
+  result->parameter = NULL;
+  result->output = NULL;
+}
+
+//! Unload the protocol description, and clean up all memory
+void
+scytherUnload (void)
+{
+  if (!enter ())
+    {
+      return;
+    }
+  unload ();
+  leave ();
+}
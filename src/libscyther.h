@@ -0,0 +1,74 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef LIBSCYTHER
+#define LIBSCYTHER
+
+/*
+ * In-process interface to the verifier, for the shared library build.
+ *
+ * This header is self-contained, so that programs embedding the verifier do
+ * not need the engine headers.
+ *
+ * The verifier is not reentrant. One protocol description can be loaded at a
+ * time, and its claims are verified one after the other. A call made while
+ * another one is running, e.g. from another thread, is rejected.
+ */
+
+//! Verification status of a claim
+enum scytherstatus
+{ SCYTHER_UNVERIFIED, SCYTHER_OK, SCYTHER_FAIL };
+
+//! Description and outcome of a single claim
+/**
+ * Filled in by scytherClaimInfo() and scytherVerify(), and released with
+ * scytherResultFree(). All strings are owned by the result.
+ */
+struct scytherresult
+{
+  //! Claim identification
+  char *protocol;
+  char *role;
+  char *type;			//!< e.g. "Secret" or "Niagree"
+  char *label;
+  char *parameter;		//!< NULL if the claim has no parameter
+  int lineno;			//!< line of the claim in the input
+
+  //! Outcome, as in the claim summary of the command-line tool
+  int status;			//!< enum scytherstatus
+  int complete;			//!< exactly that many attacks, or proof of correctness
+  int timebound;		//!< the time limit was reached
+  unsigned long failed;		//!< number of attacks found
+  unsigned long count;		//!< number of times the claim was reached
+  unsigned long states;		//!< number of states explored
+
+  //! Output of the verifier for this claim (attacks, XML), or NULL
+  char *output;
+};
+
+int scytherLoad (const char *spdl, const char *flags);
+int scytherLoadFile (const char *filename, const char *flags);
+int scytherClaimCount (void);
+int scytherClaimInfo (const int n, struct scytherresult *result);
+int scytherVerify (const int n, const char *flags,
+		   struct scytherresult *result);
+void scytherResultFree (struct scytherresult *result);
+void scytherUnload (void);
+
+#endif
@@ -28,6 +28,11 @@
 
 #include "list.h"
 #include "mymalloc.h"
+#include "slab.h"
+
+//! List nodes, set up on first use
+static struct slab listslab;
+static int listslabready = 0;
 
 //! Make a node
 List
@@ -35,13 +40,32 @@ list_create (const void *data)
 {
   List newlist;
 
-  newlist = (List) malloc (sizeof (struct list_struct));
+  if (!listslabready)
+    {
+      slabInit (&listslab, sizeof (struct list_struct));
+      listslabready = 1;
+    }
+  newlist = (List) slabAlloc (&listslab);
   newlist->prev = NULL;
   newlist->next = NULL;
   newlist->data = (void *) data;
   return newlist;
 }
 
+//! Release all list nodes
+/**
+ * Called along with termlistsDone(). The nodes are set up again on first use.
+ */
+void
+listsDone (void)
+{
+  if (listslabready)
+    {
+      slabDone (&listslab);
+      listslabready = 0;
+    }
+}
+
 //! Rewind list
 List
 list_rewind (List list)
@@ -167,7 +191,7 @@ list_delete (List list)
 
       prenode = list->prev;
       postnode = list->next;
-      free (list);
+      slabFree (&listslab, list);
       if (postnode != NULL)
 	{
 	  postnode->prev = prenode;
@@ -259,7 +283,7 @@ list_destroy (List list)
 
       node = list;
       list = list->next;
-      free (node);
+      slabFree (&listslab, node);
     }
 }
 
@@ -31,6 +31,7 @@ struct list_struct
 typedef struct list_struct *List;	//!< pointer to generic list node
 
 List list_create (const void *data);
+void listsDone (void);
 List list_rewind (List list);
 List list_forward (List list);
 List list_insert (List list, const void *data);
@@ -74,6 +74,7 @@
 #include "claim.h"
 #include "arachne.h"
 #include "xmlout.h"
+#include "server.h"
 
 //! The global system state pointer
 System sys;
@@ -127,6 +128,10 @@ main (int argc, char **argv)
   /* init compiler for this system */
   compilerInit (sys);
 
+  /* in server mode, the input comes with the requests (returns in a worker) */
+  if (switches.server)
+    serverDispatch ();
+
   /* parse input */
 
   yyparse ();
@@ -185,6 +190,10 @@ main (int argc, char **argv)
    * ---------------------------------------
    */
 
+  /* in server mode, verify per request instead (does not return) */
+  if (switches.server)
+    serverWork (sys);
+
   /* xml init */
   if (switches.xml)
     xmlOutInit ();
@@ -226,6 +235,7 @@ main (int argc, char **argv)
   symbolsDone ();
   knowledgeDone ();
   termlistsDone ();
+  listsDone ();
   termmapsDone ();
   termsDone ();
 
@@ -27,6 +27,7 @@
 #include "specialterm.h"
 #include "switches.h"
 #include "arachne.h"
+#include "error.h"
 
 /*
    Most General Unifier
@@ -34,8 +35,29 @@
    Unification etc.
 
    New version yields a termlist with substituted variables, which can later be reset to NULL.
+
+   Unification problems are solved without callbacks: the pairs still to
+   be unified are kept on a work stack, and the variables it binds are
+   pushed onto a trail, from which they are undone later. The trail is a
+   stack shared by nested unifications, because callbacks may start new
+   ones before the outer bindings are undone.
 */
 
+//! Variables bound by unifySolve(), most recent last
+static Term *trail = NULL;
+static int trailsize = 0;	//!< Allocated length of the trail
+static int trailtop = 0;	//!< Number of bound variables on the trail
+
+//! Pairs of terms still to be unified by unifySolve()
+static Term *work = NULL;
+static int worksize = 0;	//!< Allocated length of the work stack
+static int worktop = 0;		//!< Number of terms on the work stack
+
+//! Instances of subterm positions, for subtermUnifyPositions()
+static Term *posterms = NULL;
+static int postermsize = 0;	//!< Allocated length of posterms
+static int postermtop = 0;	//!< Number of posterms in use by active calls
+
 /**
  * switches.match
  * 0	typed
@@ -121,141 +143,197 @@ termlistSubstReset (Termlist tl)
     }
 }
 
-//! Most general unifier iteration
-/**
- * Try to determine the most general unifier of two terms, if so calls function.
- *
- * The callback receives a list of variables, that were previously open, but are now closed
- * in such a way that the two terms unify. 
- *
- * The callback must return true for the iteration to proceed: if it returns false, a single call would abort the scan.
- * The return value shows this: it is false if the scan was aborted, and true if not.
- */
-int
-unify (Term t1, Term t2, Termlist tl, int (*callback) (Termlist))
+//! Bind a variable and push it onto the trail.
+static void
+trailBind (Term tvar, Term tsubst)
 {
-  int callsubst (Termlist tl, Term t, Term tsubst)
-  {
-    int proceed;
-
-    t->subst = tsubst;
+  if (trailtop >= trailsize)
+    {
+      trailsize = (trailsize == 0 ? 256 : 2 * trailsize);
+      trail = (Term *) realloc (trail, trailsize * sizeof (Term));
+      if (trail == NULL)
+	{
+	  error ("Out of memory for the unification trail.");
+	}
+    }
+  tvar->subst = tsubst;
 #ifdef DEBUG
-    showSubst (t);
+  showSubst (tvar);
 #endif
-    tl = termlistAdd (tl, t);
-    proceed = callback (tl);
-    tl = termlistDelTerm (tl);
-    t->subst = NULL;
-    return proceed;
-  }
+  trail[trailtop++] = tvar;
+}
 
-  /* added for speed */
-  t1 = deVar (t1);
-  t2 = deVar (t2);
-  if (t1 == t2)
+//! Undo the bindings on the trail down to a mark.
+static void
+trailUndo (const int mark)
+{
+  while (trailtop > mark)
     {
-      return callback (tl);
+      trailtop--;
+      trail[trailtop]->subst = NULL;
     }
+}
 
-  if (!(hasTermVariable (t1) || hasTermVariable (t2)))
+//! Add the bindings on the trail above a mark to a substitution list.
+/**
+ * The most recent binding is the first node.
+ */
+static Termlist
+trailList (Termlist tl, const int mark)
+{
+  int i;
+
+  for (i = mark; i < trailtop; i++)
     {
-      // None has a variable
-      if (isTermEqual (t1, t2))
-	{
-	  // Equal!
-	  return callback (tl);
-	}
-      else
-	{
-	  // Can never be fixed, no variables
-	  return true;
-	}
+      tl = termlistAdd (tl, trail[i]);
     }
+  return tl;
+}
 
-  /*
-   * Distinguish a special case where both are unbound variables that will be
-   * connected, and I want to give one priority over the other for readability.
-   *
-   * Because t1 and t2 have been deVar'd means that if they are variables, they
-   * are also unbound.
-   */
+//! Remove the nodes added by trailList(), and undo their bindings.
+static void
+trailRelease (Termlist tl, const int mark)
+{
+  int i;
 
-  if (realTermVariable (t1) && realTermVariable (t2) && goodsubst (t1, t2))
+  for (i = mark; i < trailtop; i++)
     {
-      /* Both are unbound variables. Decide.
-       *
-       * The plan: t1->subst will point to t2. But maybe we prefer the other
-       * way around?
-       */
-      if (preferSubstitutionOrder (t2, t1))
-	{
-	  Term t3;
-
-	  // Swappy.
-	  t3 = t1;
-	  t1 = t2;
-	  t2 = t3;
-	}
-      return callsubst (tl, t1, t2);
+      tl = termlistDelTerm (tl);
     }
+  trailUndo (mark);
+}
 
-  /* symmetrical tests for single variable.
-   */
-
-  if (realTermVariable (t2))
+//! Push a pair of terms onto the work stack.
+static void
+workPush (Term ta, Term tb)
+{
+  if (worktop + 2 > worksize)
     {
-      if (termSubTerm (t1, t2) || !goodsubst (t2, t1))
-	return true;
-      else
+      worksize = (worksize == 0 ? 256 : 2 * worksize);
+      work = (Term *) realloc (work, worksize * sizeof (Term));
+      if (work == NULL)
 	{
-	  return callsubst (tl, t2, t1);
+	  error ("Out of memory for the unification work stack.");
 	}
     }
-  if (realTermVariable (t1))
+  work[worktop++] = ta;
+  work[worktop++] = tb;
+}
+
+//! Give up on unifySolve(): undo its bindings and clear the work stack.
+static int
+unifyFail (const int mark)
+{
+  trailUndo (mark);
+  worktop = 0;
+  return false;
+}
+
+//! Most general unifier on the trail
+/**
+ * Computes the unifier iteratively. Syntactic unification has at most one
+ * most general unifier, so no continuation is needed while solving.
+ *
+ *@return True if the terms unify; the new bindings are then on the trail,
+ * above the trail top at the time of the call. False if they do not, in
+ * which case no bindings are left.
+ */
+static int
+unifySolve (Term t1, Term t2)
+{
+  int mark;
+
+  mark = trailtop;
+  worktop = 0;
+  workPush (t1, t2);
+  while (worktop > 0)
     {
-      if (termSubTerm (t2, t1) || !goodsubst (t1, t2))
-	return true;
-      else
+      worktop -= 2;
+      t1 = deVar (work[worktop]);
+      t2 = deVar (work[worktop + 1]);
+
+      if (t1 == t2)
+	continue;
+
+      if (!(hasTermVariable (t1) || hasTermVariable (t2)))
 	{
-	  return callsubst (tl, t1, t2);
+	  if (isTermEqual (t1, t2))
+	    continue;
+	  else
+	    return unifyFail (mark);
 	}
-    }
 
-  /* left & right are compounds with variables */
-  if (t1->type != t2->type)
-    return true;
+      /* Both are unbound variables: preferSubstitutionOrder() decides
+       * which one points to the other, for readability.
+       */
+      if (realTermVariable (t1) && realTermVariable (t2)
+	  && goodsubst (t1, t2))
+	{
+	  if (preferSubstitutionOrder (t2, t1))
+	    {
+	      Term t3;
 
-  /* identical compound types */
+	      t3 = t1;
+	      t1 = t2;
+	      t2 = t3;
+	    }
+	  trailBind (t1, t2);
+	  continue;
+	}
 
-  /* encryption first */
-  if (realTermEncrypt (t1))
-    {
-      int unify_combined_enc (Termlist tl)
-      {
-	// now the keys are unified (subst in this tl)
-	// and we try the inner terms
-	return unify (TermOp (t1), TermOp (t2), tl, callback);
-      }
+      if (realTermVariable (t2))
+	{
+	  if (termSubTerm (t1, t2) || !goodsubst (t2, t1))
+	    return unifyFail (mark);
+	  trailBind (t2, t1);
+	  continue;
+	}
+      if (realTermVariable (t1))
+	{
+	  if (termSubTerm (t2, t1) || !goodsubst (t1, t2))
+	    return unifyFail (mark);
+	  trailBind (t1, t2);
+	  continue;
+	}
 
-      return unify (TermKey (t1), TermKey (t2), tl, unify_combined_enc);
-    }
+      if (t1->type != t2->type)
+	return unifyFail (mark);
 
-  /* tupling second
-     non-associative version ! TODO other version */
-  if (isTermTuple (t1))
-    {
-      int unify_combined_tup (Termlist tl)
-      {
-	// now the keys are unified (subst in this tl)
-	// and we try the inner terms
-	return unify (TermOp2 (t1), TermOp2 (t2), tl, callback);
-      }
-      return unify (TermOp1 (t1), TermOp1 (t2), tl, unify_combined_tup);
+      // Push the second parts first, so the first parts are unified first
+      if (realTermEncrypt (t1))
+	{
+	  workPush (TermOp (t1), TermOp (t2));
+	  workPush (TermKey (t1), TermKey (t2));
+	  continue;
+	}
+      if (isTermTuple (t1))
+	{
+	  workPush (TermOp2 (t1), TermOp2 (t2));
+	  workPush (TermOp1 (t1), TermOp1 (t2));
+	  continue;
+	}
+      return unifyFail (mark);
     }
-
   return true;
 }
 
+//! Release the unification trail and work stack.
+void
+mguDone (void)
+{
+  free (trail);
+  trail = NULL;
+  trailsize = 0;
+  trailtop = 0;
+  free (work);
+  work = NULL;
+  worksize = 0;
+  worktop = 0;
+  free (posterms);
+  posterms = NULL;
+  postermsize = 0;
+  postermtop = 0;
+}
 
 //! Subterm unification
 /**
@@ -277,11 +355,7 @@ subtermUnify (Term tbig, Term tsmall, Termlist tl, Termlist keylist,
 	      int (*callback) (Termlist, Termlist))
 {
   int proceed;
-
-  int keycallback (Termlist tl)
-  {
-    return callback (tl, keylist);
-  }
+  int mark;
 
   proceed = true;
 
@@ -291,7 +365,15 @@ subtermUnify (Term tbig, Term tsmall, Termlist tl, Termlist keylist,
 
   // Three options:
   // 1. simple unification
-  proceed = proceed && unify (tbig, tsmall, tl, keycallback);
+  mark = trailtop;
+  if (unifySolve (tbig, tsmall))
+    {
+      Termlist sl;
+
+      sl = trailList (tl, mark);
+      proceed = callback (sl, keylist);
+      trailRelease (sl, mark);
+    }
 
   // [2/3]: complex
   if (switches.intruder)
@@ -341,6 +423,172 @@ subtermUnify (Term tbig, Term tsmall, Termlist tl, Termlist keylist,
 }
 
 
+//! Append the subterm positions of a pattern to an array.
+/**
+ * The positions are those subtermUnify() visits when the pattern is the
+ * big term. Below a variable of the pattern, nothing is recorded: the
+ * variable may be instantiated differently in each run, so
+ * subtermUnifyPositions() hands such a position to subtermUnify().
+ *
+ *@param pos	Array of positions, reallocated when needed
+ *@param size	Allocated length of the array
+ *@param count	Number of positions already in the array
+ *@return The new number of positions in the array.
+ */
+int
+subtermPositions (Term t, struct subtermpos **pos, int *size, int count)
+{
+  int first;
+
+  void add_position (Term t, int parent, int step, int keys)
+  {
+    int here;
+
+    t = deVar (t);
+    if (count >= *size)
+      {
+	*size = (*size == 0 ? 64 : 2 * *size);
+	*pos = (struct subtermpos *) realloc (*pos,
+					      *size *
+					      sizeof (struct subtermpos));
+	if (*pos == NULL)
+	  {
+	    error ("Out of memory for subterm positions.");
+	  }
+      }
+    here = count - first;
+    (*pos)[count].parent = parent;
+    (*pos)[count].step = step;
+    (*pos)[count].keys = keys;
+    (*pos)[count].open = realTermVariable (t);
+    count++;
+    if ((*pos)[first + here].open || !switches.intruder)
+      return;
+    if (realTermTuple (t))
+      {
+	add_position (TermOp1 (t), here, POS_OP1, keys);
+	add_position (TermOp2 (t), here, POS_OP2, keys);
+      }
+    if (realTermEncrypt (t))
+      {
+	add_position (TermOp (t), here, POS_OP, here);
+      }
+  }
+
+  first = count;
+  add_position (t, -1, POS_OP, -1);
+  return count;
+}
+
+//! The subterm at a position
+/**
+ *@param tbig	The instance of the pattern
+ *@param pos	The position
+ *@param terms	The subterms at the positions before it, relative to the
+ * first position of the pattern
+ */
+Term
+subtermAtPosition (Term tbig, const struct subtermpos *pos,
+		   const Term * terms)
+{
+  Term t;
+
+  if (pos->parent < 0)
+    {
+      t = tbig;
+    }
+  else if (pos->step == POS_OP1)
+    {
+      t = TermOp1 (terms[pos->parent]);
+    }
+  else if (pos->step == POS_OP2)
+    {
+      t = TermOp2 (terms[pos->parent]);
+    }
+  else
+    {
+      t = TermOp (terms[pos->parent]);
+    }
+  return deVar (t);
+}
+
+//! Subterm unification over precomputed positions
+/**
+ * Same iteration and results as subtermUnify (tbig, tsmall, tl, NULL,
+ * callback), where the positions were computed by subtermPositions() from
+ * the pattern of which tbig is an instance. The subterms are found by
+ * following the positions instead of a recursive descent, and a key list is
+ * only built for the callback.
+ */
+int
+subtermUnifyPositions (Term tbig, const struct subtermpos *pos,
+		       const int count, Term tsmall, Termlist tl,
+		       int (*callback) (Termlist, Termlist))
+{
+  int base;
+  int proceed;
+  int i;
+
+  // The key list of a position, innermost encryption first
+  Termlist position_keys (int k)
+  {
+    if (k < 0)
+      return NULL;
+    return termlistAdd (position_keys (pos[k].keys), posterms[base + k]);
+  }
+
+  // Reserve instances; nested calls from the callback use the ones above
+  base = postermtop;
+  if (base + count > postermsize)
+    {
+      while (base + count > postermsize)
+	postermsize = (postermsize == 0 ? 256 : 2 * postermsize);
+      posterms = (Term *) realloc (posterms, postermsize * sizeof (Term));
+      if (posterms == NULL)
+	{
+	  error ("Out of memory for subterm positions.");
+	}
+    }
+  postermtop = base + count;
+
+  tsmall = deVar (tsmall);
+  proceed = true;
+  for (i = 0; proceed && i < count; i++)
+    {
+      Term t;
+      Termlist keylist;
+
+      t = subtermAtPosition (tbig, &(pos[i]), posterms + base);
+      posterms[base + i] = t;
+
+      if (pos[i].open)
+	{
+	  keylist = position_keys (pos[i].keys);
+	  proceed = subtermUnify (t, tsmall, tl, keylist, callback);
+	  termlistDelete (keylist);
+	}
+      else
+	{
+	  int mark;
+
+	  mark = trailtop;
+	  if (unifySolve (t, tsmall))
+	    {
+	      Termlist sl;
+
+	      keylist = position_keys (pos[i].keys);
+	      sl = trailList (tl, mark);
+	      proceed = callback (sl, keylist);
+	      trailRelease (sl, mark);
+	      termlistDelete (keylist);
+	    }
+	}
+    }
+
+  postermtop = base;
+  return proceed;
+}
+
 //! Most general unifier.
 /**
  * Try to determine the most general unifier of two terms.
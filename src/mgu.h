@@ -35,10 +35,35 @@
 void termlistSubstReset (Termlist tl);
 int checkRoletermMatch (const Term t1, const Term t2, const Termlist tl);
 
+//! Subterm position of a pattern, as visited by subtermUnify()
+/**
+ * Positions are stored in the order in which subtermUnify() visits them,
+ * so a parent always comes before its children. Indices are relative to
+ * the first position of the pattern.
+ */
+struct subtermpos
+{
+  int parent;			//!< Parent position, or -1 for the pattern itself
+  int step;			//!< Step from the parent: POS_OP, POS_OP1 or POS_OP2
+  int keys;			//!< Innermost encryption above, or -1 if there is none
+  int open;			//!< True if the pattern is a variable here
+};
+
+//! Steps from a parent position
+enum subtermsteps
+{ POS_OP, POS_OP1, POS_OP2 };
+
 // The new iteration methods
-int unify (Term t1, Term t2, Termlist tl, int (*callback) (Termlist));
 int
 subtermUnify (Term tbig, Term tsmall, Termlist tl, Termlist keylist,
 	      int (*callback) (Termlist, Termlist));
+int subtermPositions (Term t, struct subtermpos **pos, int *size,
+		      int count);
+Term subtermAtPosition (Term tbig, const struct subtermpos *pos,
+			const Term * terms);
+int subtermUnifyPositions (Term tbig, const struct subtermpos *pos,
+			   const int count, Term tsmall, Termlist tl,
+			   int (*callback) (Termlist, Termlist));
+void mguDone (void);
 
 #endif
@@ -513,4 +513,10 @@ int yyerror(char *s)
 	return 0;
 }
 
+//! forget the macros of the last parse, before parsing another file
+void parser_cleanup(void)
+{
+	list_destroy(macrolist);
+	macrolist = NULL;
+}
 
@@ -124,16 +124,14 @@ allAgentsType (const System sys)
 
   for (run = 0; run < sys->maxruns; run++)
     {
-      Termlist agents;
+      int i;
 
-      agents = sys->runs[run].rho;
-      while (agents != NULL)
+      for (i = 0; i < sys->runs[run].rho.length; i++)
 	{
-	  if (!goodAgentType (agents->term))
+	  if (!goodAgentType (sys->runs[run].rho.terms[i]))
 	    {
 	      return false;
 	    }
-	  agents = agents->next;
 	}
     }
   return true;			// seems to be okay
@@ -154,16 +152,14 @@ initiatorAgentsType (const System sys)
       // Only for initiators
       if (sys->runs[run].role->initiator)
 	{
-	  Termlist agents;
+	  int i;
 
-	  agents = sys->runs[run].rho;
-	  while (agents != NULL)
+	  for (i = 0; i < sys->runs[run].rho.length; i++)
 	    {
-	      if (!goodAgentType (agents->term))
+	      if (!goodAgentType (sys->runs[run].rho.terms[i]))
 		{
 		  return false;
 		}
-	      agents = agents->next;
 	    }
 	}
       run++;
@@ -443,7 +439,7 @@ so technically this is a bug. Don't use.
 	{
 	  if (sys->runs[run].protocol != INTRUDER)
 	    {
-	      if (sys->runs[run].rho != NULL)
+	      if (sys->runs[run].rho.length > 0)
 		{
 		  Term actor;
 
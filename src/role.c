@@ -209,6 +209,7 @@ roledefInit (int type, Term label, Term from, Term to, Term msg, Claimlist cl)
     newEvent->bound = 0;	// bound goal (Used for arachne only). Technically involves choose events as well.
   else
     newEvent->bound = 1;	// other stuff does not need to be bound
+  newEvent->sendentry = -1;	// not in the send index (yet)
   newEvent->next = NULL;
   newEvent->lineno = 0;
   return newEvent;
@@ -129,6 +129,7 @@ struct roledef
    * Bindings for Arachne engine
    */
   int bound;			//!< determines whether it is already bound
+  int sendentry;		//!< Send index entry of a role send, or -1; copied to the runs
 
   /* evt runid for synchronisation, but that is implied in the
      base array */
@@ -0,0 +1,507 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *@file server.c
+ *
+ * Persistent verification server (--server).
+ *
+ * Scripts that verify many (often the same) protocol descriptions pay for
+ * starting the tool, scanning, compiling and preprocessing the input every
+ * time. In server mode, the tool instead reads verification requests from
+ * stdin, and writes the answers to stdout.
+ *
+ * A request consists of a header line and the protocol description:
+ *
+ *   verify <bytes> [switches]\n
+ *   <bytes bytes of SPDL input>
+ *
+ * The switches apply to this request only, e.g. "--xml-output" or
+ * "--filter=ns3,I3"; the switches given to the server itself apply to all
+ * requests, and are the only ones that influence the compilation. The
+ * answer is
+ *
+ *   ok <bytes>\n<bytes bytes of output>       or
+ *   error <bytes>\n<bytes bytes of error messages>
+ *
+ * where the output is what the tool would have written to stdout for the
+ * same input. The server stops at the end of its input, or at a line "quit".
+ *
+ * The dispatcher (the original process) never parses anything itself. For
+ * every new protocol description, it forks a worker, which returns into
+ * main() to parse and compile the description as usual, and then calls
+ * serverWork() instead of verifying the claims. The worker forks a fresh
+ * process for each request, which inherits the compiled system, verifies the
+ * claims, and exits. The dispatcher keeps the workers of the last
+ * SERVER_CACHE distinct descriptions, keyed by a hash of the input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FORWINDOWS
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "system.h"
+#include "arachne.h"
+#include "switches.h"
+#include "tempfile.h"
+#include "xmlout.h"
+#include "error.h"
+#include "server.h"
+
+//! Maximum number of compiled protocol descriptions kept around.
+#define SERVER_CACHE	16
+
+//! Maximum length of a request header line.
+#define SERVER_HEADER	4096
+
+//! A worker process that holds a compiled protocol description.
+struct serverworker
+{
+  unsigned long hash;		//!< Hash of the input
+  char *spdl;			//!< The input itself, to rule out collisions
+  size_t length;		//!< Length of the input
+  int pid;			//!< Process id, or 0 for an empty slot
+  int request;			//!< Write end of the request pipe
+  int response;			//!< Read end of the response pipe
+  FILE *errors;			//!< Captured stderr of the worker
+  unsigned long used;		//!< Time of last use, for eviction
+};
+
+//! Header of a response from a worker to the dispatcher.
+struct serverresponse
+{
+  int ok;			//!< True iff the verification process succeeded
+  size_t length;		//!< Number of bytes of output that follow
+};
+
+void scanner_start (FILE * input);
+
+//! Worker side: the request and response pipes.
+static int worker_request = -1;
+static int worker_response = -1;
+
+#ifndef FORWINDOWS
+
+//! Read exactly n bytes, unless the other end is closed first.
+static int
+readFully (const int fd, void *buffer, const size_t n)
+{
+  size_t done;
+  ssize_t r;
+
+  done = 0;
+  while (done < n)
+    {
+      r = read (fd, (char *) buffer + done, n - done);
+      if (r <= 0)
+	{
+	  return false;
+	}
+      done += r;
+    }
+  return true;
+}
+
+//! Write exactly n bytes.
+static int
+writeFully (const int fd, const void *buffer, const size_t n)
+{
+  size_t done;
+  ssize_t r;
+
+  done = 0;
+  while (done < n)
+    {
+      r = write (fd, (const char *) buffer + done, n - done);
+      if (r <= 0)
+	{
+	  return false;
+	}
+      done += r;
+    }
+  return true;
+}
+
+//! Read the contents of a captured stream into a fresh buffer.
+static char *
+serverSlurp (FILE * fp, size_t * length)
+{
+  char *buffer;
+
+  fflush (fp);
+  *length = ftell (fp);
+  buffer = (char *) malloc (*length + 1);
+  rewind (fp);
+  *length = fread (buffer, 1, *length, fp);
+  return buffer;
+}
+
+//! Hash of a protocol description (djb2).
+static unsigned long
+serverHash (const char *s, const size_t length)
+{
+  unsigned long h;
+  size_t i;
+
+  h = 5381;
+  for (i = 0; i < length; i++)
+    {
+      h = h * 33 + (unsigned char) s[i];
+    }
+  return h;
+}
+
+//! Write an answer to stdout.
+static void
+serverAnswer (const int ok, const char *buffer, const size_t length)
+{
+  printf ("%s %lu\n", (ok ? "ok" : "error"), (unsigned long) length);
+  fwrite (buffer, 1, length, stdout);
+  fflush (stdout);
+}
+
+//! Stop a worker and free its slot.
+static void
+serverWorkerStop (struct serverworker *w)
+{
+  int status;
+
+  close (w->request);
+  close (w->response);
+  waitpid (w->pid, &status, 0);
+  fclose (w->errors);
+  free (w->spdl);
+  w->pid = 0;
+}
+
+//! Start a worker for a protocol description.
+/**
+ * In the worker, this returns false, and the worker should go on to parse
+ * the description; the dispatcher gets true.
+ */
+static int
+serverWorkerStart (struct serverworker *workers, struct serverworker *w)
+{
+  int request[2];
+  int response[2];
+  int i;
+
+  if (pipe (request) != 0 || pipe (response) != 0)
+    {
+      error ("Could not create the pipes for a server worker.");
+    }
+  w->errors = scyther_tempfile ();
+  fflush (stdout);
+  fflush (stderr);
+  w->pid = fork ();
+  if (w->pid < 0)
+    {
+      error ("Could not fork a server worker.");
+    }
+  if (w->pid == 0)
+    {
+      FILE *input;
+
+      // Worker: drop the pipes of the other workers, so they see the end
+      // of their requests when the dispatcher closes them.
+      for (i = 0; i < SERVER_CACHE; i++)
+	{
+	  if (workers[i].pid != 0 && &workers[i] != w)
+	    {
+	      close (workers[i].request);
+	      close (workers[i].response);
+	    }
+	}
+      close (request[1]);
+      close (response[0]);
+      worker_request = request[0];
+      worker_response = response[1];
+      // Requests only come through the pipe, and anything the compiler
+      // prints is only shown if the description turns out to be broken.
+      // At the descriptor level, as closing the stdin stream could move
+      // the read position of the dispatcher.
+      if (dup2 (open ("/dev/null", O_RDONLY), fileno (stdin)) < 0
+	  || dup2 (fileno (w->errors), fileno (stdout)) < 0
+	  || dup2 (fileno (w->errors), fileno (stderr)) < 0)
+	{
+	  _exit (EXIT_ERROR);
+	}
+
+      input = scyther_tempfile ();
+      fwrite (w->spdl, 1, w->length, input);
+      rewind (input);
+      scanner_start (input);
+      return false;
+    }
+  close (request[0]);
+  close (response[1]);
+  w->request = request[1];
+  w->response = response[0];
+  return true;
+}
+
+//! Find the worker for a protocol description, or start one.
+/**
+ *@return NULL in a newly started worker process.
+ */
+static struct serverworker *
+serverWorkerGet (struct serverworker *workers, char *spdl,
+		 const size_t length, const unsigned long now)
+{
+  struct serverworker *w;
+  unsigned long hash;
+  int i;
+
+  hash = serverHash (spdl, length);
+  w = &workers[0];
+  for (i = 0; i < SERVER_CACHE; i++)
+    {
+      if (workers[i].pid != 0 && workers[i].hash == hash
+	  && workers[i].length == length
+	  && memcmp (workers[i].spdl, spdl, length) == 0)
+	{
+	  free (spdl);
+	  workers[i].used = now;
+	  return &workers[i];
+	}
+      // Otherwise remember an empty slot, or the least recently used one
+      if (w->pid != 0 && (workers[i].pid == 0 || workers[i].used < w->used))
+	{
+	  w = &workers[i];
+	}
+    }
+  if (w->pid != 0)
+    {
+      serverWorkerStop (w);
+    }
+  w->hash = hash;
+  w->spdl = spdl;
+  w->length = length;
+  w->used = now;
+  if (!serverWorkerStart (workers, w))
+    {
+      return NULL;
+    }
+  return w;
+}
+
+//! Pass a request to a worker, and answer it.
+static void
+serverRequest (struct serverworker *w, const char *flags)
+{
+  struct serverresponse res;
+  size_t length;
+  char *buffer;
+
+  length = strlen (flags);
+  if (writeFully (w->request, &length, sizeof (length))
+      && writeFully (w->request, flags, length)
+      && readFully (w->response, &res, sizeof (res)))
+    {
+      buffer = (char *) malloc (res.length + 1);
+      if (readFully (w->response, buffer, res.length))
+	{
+	  serverAnswer (res.ok, buffer, res.length);
+	  free (buffer);
+	  return;
+	}
+      free (buffer);
+    }
+
+  // The worker is gone, typically because the input could not be compiled
+  buffer = serverSlurp (w->errors, &length);
+  serverAnswer (false, buffer, length);
+  free (buffer);
+  serverWorkerStop (w);
+}
+
+#endif
+
+//! Dispatcher: read requests until the end of the input.
+/**
+ * Only returns in a newly started worker, which should then parse its
+ * protocol description from the scanner input.
+ */
+void
+serverDispatch (void)
+{
+#ifdef FORWINDOWS
+  error ("Server mode (--server) is not supported on Windows.");
+#else
+  struct serverworker workers[SERVER_CACHE];
+  char header[SERVER_HEADER];
+  unsigned long now;
+  int i;
+
+  // A worker that dies should not take the dispatcher with it
+  signal (SIGPIPE, SIG_IGN);
+  for (i = 0; i < SERVER_CACHE; i++)
+    {
+      workers[i].pid = 0;
+    }
+
+  now = 0;
+  while (fgets (header, SERVER_HEADER, stdin) != NULL)
+    {
+      struct serverworker *w;
+      unsigned long length;
+      char *flags;
+      char *spdl;
+      int offset;
+
+      if (strncmp (header, "quit", 4) == 0)
+	{
+	  break;
+	}
+      offset = 0;
+      if (sscanf (header, "verify %lu %n", &length, &offset) < 1
+	  || offset == 0)
+	{
+	  const char *msg = "Could not parse request header.\n";
+
+	  serverAnswer (false, msg, strlen (msg));
+	  continue;
+	}
+      flags = header + offset;
+      flags[strcspn (flags, "\r\n")] = '\0';
+
+      spdl = (char *) malloc (length + 1);
+      if (fread (spdl, 1, length, stdin) != length)
+	{
+	  free (spdl);
+	  break;
+	}
+      spdl[length] = '\0';
+
+      now++;
+      w = serverWorkerGet (workers, spdl, length, now);
+      if (w == NULL)
+	{
+	  // We are the new worker: go and compile the description
+	  return;
+	}
+      serverRequest (w, flags);
+    }
+
+  for (i = 0; i < SERVER_CACHE; i++)
+    {
+      if (workers[i].pid != 0)
+	{
+	  serverWorkerStop (&workers[i]);
+	}
+    }
+  exit (0);
+#endif
+}
+
+//! Worker: answer requests for the compiled protocol description.
+/**
+ * Called instead of the verification in main(). Each request is verified
+ * in a fresh process, so nothing of a request carries over to the next one.
+ * Does not return.
+ */
+void
+serverWork (const System sys)
+{
+#ifndef FORWINDOWS
+  size_t length;
+  char *flags;
+
+  while (readFully (worker_request, &length, sizeof (length)))
+    {
+      struct serverresponse res;
+      FILE *out;
+      FILE *err;
+      char *buffer;
+      int status;
+      int pid;
+
+      flags = (char *) malloc (length + 1);
+      if (!readFully (worker_request, flags, length))
+	{
+	  break;
+	}
+      flags[length] = '\0';
+
+      out = scyther_tempfile ();
+      err = scyther_tempfile ();
+      fflush (stdout);
+      fflush (stderr);
+      pid = fork ();
+      if (pid < 0)
+	{
+	  error ("Could not fork a verification process.");
+	}
+      if (pid == 0)
+	{
+	  if (dup2 (fileno (out), fileno (stdout)) < 0
+	      || dup2 (fileno (err), fileno (stderr)) < 0)
+	    {
+	      _exit (EXIT_ERROR);
+	    }
+	  process_switch_buffer (flags);
+
+	  if (switches.xml)
+	    xmlOutInit ();
+	  systemReset (sys);
+	  systemRuns (sys);
+	  // As modelCheck() in main.c, which is not part of the library
+	  if (arachne () == 0)
+	    {
+	      warning ("No claims in system.");
+	    }
+	  if (switches.xml)
+	    xmlOutDone ();
+
+	  fflush (stdout);
+	  fflush (stderr);
+	  _exit (0);
+	}
+      waitpid (pid, &status, 0);
+      free (flags);
+
+      res.ok = (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+      if (res.ok)
+	{
+	  buffer = serverSlurp (out, &res.length);
+	}
+      else
+	{
+	  buffer = serverSlurp (err, &res.length);
+	}
+      fclose (out);
+      fclose (err);
+      if (!writeFully (worker_response, &res, sizeof (res))
+	  || !writeFully (worker_response, buffer, res.length))
+	{
+	  break;
+	}
+      free (buffer);
+    }
+#endif
+  _exit (0);
+}
@@ -0,0 +1,248 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *@file slab.c
+ * Slab allocation for small fixed-size nodes
+ *
+ * Terms, termlists, termmaps and list nodes are allocated and freed millions
+ * of times per claim. Each type has its own slab: a free list threaded through
+ * chunks of SLABCHUNK bytes. The chunks are aligned to their size, so the
+ * chunk header of any node is found by masking its address. The header counts
+ * the live nodes, which lets slabsTrim() return empty chunks to the system
+ * after each claim.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "slab.h"
+#include "bool.h"
+#include "error.h"
+#include "mymalloc.h"
+
+//! Bytes per chunk, a power of two
+#define SLABCHUNK	65536
+
+//! Header at the start of each chunk
+struct slabchunk
+{
+  struct slabchunk *next;	//!< Next chunk of the same slab
+  unsigned int live;		//!< Number of nodes handed out
+  double align;			//!< Keeps the nodes after the header aligned
+};
+
+//! Registered slabs, trimmed together by slabsTrim()
+static Slab slablist = NULL;
+
+//! Find the chunk of a node
+#define chunkOf(p)	((struct slabchunk *) ((uintptr_t) (p) & ~((uintptr_t) SLABCHUNK - 1)))
+
+//! Allocate an aligned chunk
+static struct slabchunk *
+chunkAlloc (void)
+{
+  void *mem;
+
+#ifdef FORWINDOWS
+  mem = _aligned_malloc (SLABCHUNK, SLABCHUNK);
+#else
+  if (posix_memalign (&mem, SLABCHUNK, SLABCHUNK) != 0)
+    {
+      mem = NULL;
+    }
+#endif
+  if (mem == NULL)
+    {
+      error ("Out of memory for a slab chunk.");
+    }
+  return (struct slabchunk *) mem;
+}
+
+//! Release an aligned chunk
+static void
+chunkFree (struct slabchunk *c)
+{
+#ifdef FORWINDOWS
+  _aligned_free (c);
+#else
+  free (c);
+#endif
+}
+
+//! Initialise a slab for nodes of a given size, and register it.
+void
+slabInit (Slab s, const size_t size)
+{
+  Slab scan;
+
+  s->size = (size + sizeof (void *) - 1) & ~(sizeof (void *) - 1);
+  s->perchunk = (SLABCHUNK - sizeof (struct slabchunk)) / s->size;
+  s->freelist = NULL;
+  s->chunks = NULL;
+
+  for (scan = slablist; scan != NULL; scan = scan->nextslab)
+    {
+      if (scan == s)
+	return;
+    }
+  s->nextslab = slablist;
+  slablist = s;
+}
+
+//! Add a chunk of free nodes to a slab.
+static void
+slabGrow (Slab s)
+{
+  struct slabchunk *c;
+  char *base;
+  unsigned int i;
+
+  c = chunkAlloc ();
+  c->live = 0;
+  c->next = s->chunks;
+  s->chunks = c;
+
+  /* push in reverse, so that nodes are handed out in address order */
+  base = (char *) (c + 1);
+  i = s->perchunk;
+  while (i > 0)
+    {
+      void **node;
+
+      i--;
+      node = (void **) (base + i * s->size);
+      *node = s->freelist;
+      s->freelist = node;
+    }
+}
+
+//! Allocate a node.
+/**
+ *@return Uninitialised memory of the slab's node size.
+ */
+void *
+slabAlloc (Slab s)
+{
+  void **node;
+
+  if (s->freelist == NULL)
+    {
+      slabGrow (s);
+    }
+  node = (void **) s->freelist;
+  s->freelist = *node;
+  chunkOf (node)->live++;
+  return node;
+}
+
+//! Return a node to its slab.
+void
+slabFree (Slab s, void *p)
+{
+  if (p == NULL)
+    return;
+  chunkOf (p)->live--;
+  *((void **) p) = s->freelist;
+  s->freelist = p;
+}
+
+//! Return the chunks without live nodes to the system.
+void
+slabTrim (Slab s)
+{
+  struct slabchunk **cp;
+  void **fp;
+  int empty;
+
+  empty = false;
+  for (cp = &s->chunks; *cp != NULL; cp = &(*cp)->next)
+    {
+      if ((*cp)->live == 0)
+	{
+	  empty = true;
+	  break;
+	}
+    }
+  if (!empty)
+    return;
+
+  /* drop the free nodes that live in empty chunks */
+  fp = (void **) &s->freelist;
+  while (*fp != NULL)
+    {
+      void **node = (void **) *fp;
+
+      if (chunkOf (node)->live == 0)
+	{
+	  *fp = *node;
+	}
+      else
+	{
+	  fp = node;
+	}
+    }
+
+  /* release the empty chunks */
+  cp = &s->chunks;
+  while (*cp != NULL)
+    {
+      struct slabchunk *c = *cp;
+
+      if (c->live == 0)
+	{
+	  *cp = c->next;
+	  chunkFree (c);
+	}
+      else
+	{
+	  cp = &c->next;
+	}
+    }
+}
+
+//! Release all memory of a slab, live nodes included.
+void
+slabDone (Slab s)
+{
+  while (s->chunks != NULL)
+    {
+      struct slabchunk *c = s->chunks;
+
+      s->chunks = c->next;
+      chunkFree (c);
+    }
+  s->freelist = NULL;
+}
+
+//! Trim all registered slabs.
+/**
+ * Called after each claim, when the search has freed its nodes.
+ */
+void
+slabsTrim (void)
+{
+  Slab s;
+
+  for (s = slablist; s != NULL; s = s->nextslab)
+    {
+      slabTrim (s);
+    }
+}
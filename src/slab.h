@@ -0,0 +1,49 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SLAB
+#define SLAB
+
+#include <stddef.h>
+
+//! Allocator for fixed-size nodes (terms, termlists, ...)
+/**
+ * Nodes are carved out of aligned chunks and recycled through a free list,
+ * like the symbols in symbol.c. Chunks that hold no live nodes are handed
+ * back to the system by slabsTrim().
+ */
+struct slab
+{
+  size_t size;			//!< Node size in bytes
+  unsigned int perchunk;	//!< Nodes per chunk
+  void *freelist;		//!< Free nodes, linked through their first word
+  struct slabchunk *chunks;	//!< All chunks of this slab
+  struct slab *nextslab;	//!< Next registered slab, for slabsTrim()
+};
+
+typedef struct slab *Slab;
+
+void slabInit (Slab s, const size_t size);
+void *slabAlloc (Slab s);
+void slabFree (Slab s, void *p);
+void slabTrim (Slab s);
+void slabDone (Slab s);
+void slabsTrim (void);
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ *
+ *@file statecache.c
+ *
+ * Cache of explored states for the Arachne engine.
+ *
+ * Different binding orders often lead to the same semitrace, whose proof
+ * tree then does not need to be explored again. The cache holds the
+ * canonical forms (see symmetry.c) of the states whose proof tree has been
+ * explored for the current claim.
+ *
+ * Its memory is bounded. When a new form does not fit, older forms are
+ * evicted with the clock algorithm: the hand passes over the forms, and
+ * evicts the first one that has not been hit since the hand last passed.
+ * Evicting a form only costs reduction, so the search stays sound.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "statecache.h"
+#include "switches.h"
+#include "debug.h"
+#include "error.h"
+
+//! Size of the cache in MB when only --symmetry is given
+#define STATECACHE_DEFAULT	128
+
+//! A slot of the cache
+struct cacheentry
+{
+  Symmform form;		//!< The form, or NULL for a free slot
+  int referenced;		//!< Hit since the clock hand passed
+  int next;			//!< Next slot in the bucket or free list, or -1
+};
+
+static struct cacheentry *entries = NULL;	//!< The slots
+static int entrymax = 0;	//!< Number of slots
+static int freeslot = -1;	//!< First free slot
+static int *buckets = NULL;	//!< First slot of each bucket, or -1
+static int bucketcount = 0;	//!< Number of buckets, a power of two
+static int formcount = 0;	//!< Number of cached forms
+static int hand = 0;		//!< Slot of the clock hand
+static size_t cachebytes = 0;	//!< Memory taken by the cached forms
+static int evictions = 0;	//!< Number of forms evicted for the current claim
+
+//! Check whether the state cache is used
+int
+stateCacheUsed (void)
+{
+  return (switches.stateCache > 0 || switches.symmetry);
+}
+
+//! Maximum memory for the cached forms
+static size_t
+stateCacheLimit (void)
+{
+  if (switches.stateCache > 0)
+    {
+      return (size_t) switches.stateCache << 20;
+    }
+  return (size_t) STATECACHE_DEFAULT << 20;
+}
+
+//! Memory taken by a form
+static size_t
+formBytes (const Symmform f)
+{
+  return sizeof (struct symmform) + f->length * sizeof (size_t);
+}
+
+//! Forget all forms, for a new claim
+void
+stateCacheClear (void)
+{
+  int i;
+
+#ifdef DEBUG
+  if (DEBUGL (1) && (formcount > 0 || evictions > 0))
+    {
+      eprintf ("State cache held %i forms, and evicted %i.\n", formcount,
+	       evictions);
+    }
+#endif
+  for (i = 0; i < entrymax; i++)
+    {
+      symmetryFormDelete (entries[i].form);
+    }
+  free (entries);
+  entries = NULL;
+  entrymax = 0;
+  freeslot = -1;
+  free (buckets);
+  buckets = NULL;
+  bucketcount = 0;
+  formcount = 0;
+  hand = 0;
+  cachebytes = 0;
+  evictions = 0;
+}
+
+//! Release the cache
+void
+stateCacheDone (void)
+{
+  stateCacheClear ();
+}
+
+//! Check whether a state with this form was explored for the current claim
+/**
+ * A hit protects the form from the next pass of the clock hand.
+ */
+int
+stateCacheFind (const Symmform f)
+{
+  int i;
+
+  if (bucketcount == 0)
+    {
+      return false;
+    }
+  for (i = buckets[f->hash & (bucketcount - 1)]; i >= 0; i = entries[i].next)
+    {
+      Symmform g;
+
+      g = entries[i].form;
+      if (g->hash == f->hash && g->length == f->length &&
+	  memcmp (g->words, f->words, f->length * sizeof (size_t)) == 0)
+	{
+	  entries[i].referenced = true;
+	  return true;
+	}
+    }
+  return false;
+}
+
+//! Remove the form in a slot
+static void
+stateCacheRemove (const int slot)
+{
+  Symmform f;
+  int *link;
+
+  f = entries[slot].form;
+  link = &buckets[f->hash & (bucketcount - 1)];
+  while (*link != slot)
+    {
+      link = &entries[*link].next;
+    }
+  *link = entries[slot].next;
+  cachebytes -= formBytes (f);
+  formcount--;
+  symmetryFormDelete (f);
+  entries[slot].form = NULL;
+  entries[slot].next = freeslot;
+  freeslot = slot;
+}
+
+//! Evict one form, using the clock algorithm
+/**
+ * Requires at least one cached form.
+ */
+static void
+stateCacheEvict (void)
+{
+  for (;;)
+    {
+      if (hand >= entrymax)
+	{
+	  hand = 0;
+	}
+      if (entries[hand].form != NULL)
+	{
+	  if (!entries[hand].referenced)
+	    {
+	      stateCacheRemove (hand);
+	      hand++;
+	      evictions++;
+	      return;
+	    }
+	  entries[hand].referenced = false;
+	}
+      hand++;
+    }
+}
+
+//! Double the number of slots
+static void
+stateCacheGrowSlots (void)
+{
+  struct cacheentry *grown;
+  int newmax;
+  int i;
+
+  newmax = (entrymax == 0 ? 1024 : 2 * entrymax);
+  grown = (struct cacheentry *) realloc (entries,
+					 newmax * sizeof (struct cacheentry));
+  if (grown == NULL)
+    {
+      error ("Out of memory for the state cache.");
+    }
+  entries = grown;
+  for (i = newmax - 1; i >= entrymax; i--)
+    {
+      entries[i].form = NULL;
+      entries[i].referenced = false;
+      entries[i].next = freeslot;
+      freeslot = i;
+    }
+  entrymax = newmax;
+}
+
+//! Double the number of buckets, and rehash the forms
+static void
+stateCacheGrowBuckets (void)
+{
+  int newcount;
+  int i;
+
+  newcount = (bucketcount == 0 ? 1024 : 2 * bucketcount);
+  free (buckets);
+  buckets = (int *) malloc (newcount * sizeof (int));
+  if (buckets == NULL)
+    {
+      error ("Out of memory for the state cache.");
+    }
+  bucketcount = newcount;
+  for (i = 0; i < bucketcount; i++)
+    {
+      buckets[i] = -1;
+    }
+  for (i = 0; i < entrymax; i++)
+    {
+      if (entries[i].form != NULL)
+	{
+	  int b;
+
+	  b = entries[i].form->hash & (bucketcount - 1);
+	  entries[i].next = buckets[b];
+	  buckets[b] = i;
+	}
+    }
+}
+
+//! Remember that a state with this form has been explored
+/**
+ * The cache takes over the form. Older forms are evicted until it fits; a
+ * form that is larger than the whole cache is dropped.
+ */
+void
+stateCacheAdd (Symmform f)
+{
+  size_t bytes;
+  int slot;
+  int b;
+
+  bytes = formBytes (f);
+  if (bytes > stateCacheLimit ())
+    {
+      symmetryFormDelete (f);
+      return;
+    }
+  while (formcount > 0 && cachebytes + bytes > stateCacheLimit ())
+    {
+      stateCacheEvict ();
+    }
+  if (freeslot < 0)
+    {
+      stateCacheGrowSlots ();
+    }
+  if (formcount >= bucketcount)
+    {
+      stateCacheGrowBuckets ();
+    }
+  slot = freeslot;
+  freeslot = entries[slot].next;
+  b = f->hash & (bucketcount - 1);
+  entries[slot].form = f;
+  entries[slot].referenced = true;
+  entries[slot].next = buckets[b];
+  buckets[b] = slot;
+  formcount++;
+  cachebytes += bytes;
+}
@@ -33,6 +33,7 @@
 #include "switches.h"
 #include "error.h"
 #include "specialterm.h"
+#include "heuristic.h"
 
 // Program name
 const char *progname = "scyther";
@@ -49,6 +50,8 @@ char *lastfoundprefix = NULL;
 // Forward declarations
 void process_environment (void);
 int process_switches (int commandline);
+static void process_switch_args (char *args_source);
+static void switchesCheck (void);
 
 //! Init switches
 /**
@@ -71,9 +74,13 @@ switchesInit (int argc, char **argv)
   switches.maxAttacks = 0;	// no maximum default
   switches.maxOfRole = 0;	// no maximum default
   switches.oneRolePerAgent = 0;	// agents can perform multiple roles
+  switches.symmetry = false;	// default explores symmetric states again
+  switches.stateCache = 0;	// default does not remember explored states
 
   // Arachne
   switches.heuristic = 674;	// default goal selection method (used to be 162)
+  switches.goalSelect = NULL;	// default selects goals by the heuristic mask
+  switches.goalWeights = NULL;	// no feature weights file
   switches.maxIntruderActions = INT_MAX;	// max number of encrypt/decrypt events
   switches.agentTypecheck = 1;	// default do check agent types
   switches.concrete = true;	// default removes symbols, and makes traces concrete
@@ -85,6 +92,9 @@ switchesInit (int argc, char **argv)
   switches.agentUnfold = 0;	// default not to unfold agents
   switches.abstractionMethod = 0;	// default no abstraction used
   switches.useAttackBuffer = false;	// don't use by default as it does not work properly under windows vista yet
+  switches.jobs = 1;		// default verifies claims one by one
+  switches.splitDepth = 0;	// default does not split the proof tree
+  switches.portfolio = 0;	// default uses a single heuristic
 
   // Misc
   switches.switchP = 0;		// multi-purpose parameter
@@ -94,6 +104,8 @@ switchesInit (int argc, char **argv)
   switches.addallclaims = false;	// add all sorts of claims
   switches.check = false;	// check the protocol for termination etc. (default off)
   switches.expert = false;	// expert mode (off by default)
+  switches.server = false;	// default verifies a single input
+  switches.hashCons = false;	// default gives every compound term its own node
 
   // Output
   switches.output = SUMMARY;	// default is to show a summary
@@ -119,6 +131,7 @@ switchesInit (int argc, char **argv)
   switches.argc = argc;
   switches.argv = argv;
   process_switches (true);
+  switchesCheck ();
 }
 
 //! Exit
@@ -127,6 +140,7 @@ switchesDone (void)
 {
   if (lastfoundprefix != NULL)
     free (lastfoundprefix);
+  lastfoundprefix = NULL;
 }
 
 //! Open a (protocol) file.
@@ -964,12 +978,44 @@ switcher (const int process, int index, int commandline)
 	{
 	  if (switches.expert)
 	    {
-	      helptext ("    --heuristic=<int>", "use heuristic <int> [674]");
+	      helptext ("    --heuristic=<int|name>",
+			"use heuristic mask <int>, or 'masked', 'random' or 'weights' [674]");
 	    }
 	}
       else
 	{
-	  switches.heuristic = integer_argument ();
+	  char *arg;
+	  int mask;
+
+	  arg = string_argument ();
+	  if (sscanf (arg, "%i", &mask) == 1)
+	    {
+	      switches.heuristic = mask;
+	      switches.goalSelect = NULL;
+	    }
+	  else
+	    {
+	      switches.goalSelect = goalSelector (arg);
+	    }
+	  return index;
+	}
+    }
+
+  if (detect (' ', "heuristic-weights", 1))
+    {
+      if (!process)
+	{
+	  if (switches.expert)
+	    {
+	      helptext ("    --heuristic-weights=<file>",
+			"select goals using the feature weights in <file>");
+	    }
+	}
+      else
+	{
+	  switches.goalWeights = string_argument ();
+	  loadFeatureWeights (switches.goalWeights);
+	  switches.goalSelect = goalSelector ("weights");
 	  return index;
 	}
     }
@@ -1250,6 +1296,38 @@ switcher (const int process, int index, int commandline)
 	}
     }
 
+  if (detect (' ', "symmetry", 0))
+    {
+      if (!process)
+	{
+	  helptext ("    --symmetry",
+		    "prune states that equal an explored one up to renaming runs and agents");
+	}
+      else
+	{
+	  switches.symmetry = true;
+	  return index;
+	}
+    }
+
+  if (detect (' ', "state-cache", 1))
+    {
+      if (!process)
+	{
+	  helptext ("    --state-cache=<int>",
+		    "skip states equal to explored ones, remembering up to <int> MB of them [0]");
+	}
+      else
+	{
+	  switches.stateCache = integer_argument ();
+	  if (switches.stateCache < 0)
+	    {
+	      error ("--state-cache needs a size of at least 0 MB.");
+	    }
+	  return index;
+	}
+    }
+
 
   /* ==================
    *  Misc switches
@@ -1259,6 +1337,86 @@ switcher (const int process, int index, int commandline)
     printf ("Misc. switches:\n");
 
 
+  if (detect ('j', "jobs", 1))
+    {
+      if (!process)
+	{
+	  helptext ("-j, --jobs=<int>",
+		    "verify up to <int> claims in parallel [1]");
+	}
+      else
+	{
+	  switches.jobs = integer_argument ();
+	  if (switches.jobs < 1)
+	    {
+	      error ("--jobs=<int> needs a positive number of jobs.");
+	    }
+	  return index;
+	}
+    }
+
+  if (detect (' ', "split-depth", 1))
+    {
+      if (!process)
+	{
+	  if (switches.expert)
+	    {
+	      helptext ("    --split-depth=<int>",
+			"with --jobs, explore proof tree alternatives up to depth <int> in parallel, instead of claims [0]");
+	    }
+	}
+      else
+	{
+	  switches.splitDepth = integer_argument ();
+	  return index;
+	}
+    }
+
+  if (detect (' ', "portfolio", 1))
+    {
+      if (!process)
+	{
+	  helptext ("    --portfolio=<int>",
+		    "race up to <int> heuristics per claim, and keep the first decisive answer [0]");
+	}
+      else
+	{
+	  switches.portfolio = integer_argument ();
+	  return index;
+	}
+    }
+
+  if (detect (' ', "hash-cons", 0))
+    {
+      if (!process)
+	{
+	  if (switches.expert)
+	    {
+	      helptext ("    --hash-cons",
+			"share structurally equal ground terms, making their comparison a pointer test");
+	    }
+	}
+      else
+	{
+	  switches.hashCons = true;
+	  return index;
+	}
+    }
+
+  if (detect (' ', "server", 0))
+    {
+      if (!process)
+	{
+	  helptext ("    --server",
+		    "answer verification requests on stdin, reusing compiled protocols");
+	}
+      else
+	{
+	  switches.server = true;
+	  return index;
+	}
+    }
+
   if (detect ('E', "expert", 0))
     {
       if (!process)
@@ -1612,12 +1770,36 @@ switcher (const int process, int index, int commandline)
   return 0;
 }
 
+//! Check that the switches in effect can be used together
+/**
+ * Called once a complete set of switches has been processed, so that
+ * switches that depend on each other can be given in any order.
+ */
+static void
+switchesCheck (void)
+{
+  if (switches.goalSelect == goalSelector ("weights")
+      && switches.goalWeights == NULL)
+    {
+      error ("--heuristic=weights needs --heuristic-weights=<file>.");
+    }
+}
+
 //! Process a single buffer as a potential switch
 /**
- * This is a public function. It is used for the environment variables but also for the in-specification defines.
+ * This is a public function. It is used for the in-specification defines,
+ * and for the flags of the server and the library.
  */
 void
 process_switch_buffer (char *args_source)
+{
+  process_switch_args (args_source);
+  switchesCheck ();
+}
+
+//! Split a buffer into arguments, and process them as switches
+static void
+process_switch_args (char *args_source)
 {
   int arg_string_len;
 
@@ -1680,7 +1862,8 @@ process_environment (void)
   char *flags;
 
   flags = getenv ("SCYTHERFLAGS");
-  process_switch_buffer (flags);
+  // Checked along with the command line, see switchesInit()
+  process_switch_args (flags);
 }
 
 //! Process switches
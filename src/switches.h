@@ -26,6 +26,8 @@
 void switchesInit ();
 void switchesDone ();
 
+struct goalselector;
+
 //! Command-line switches structure
 struct switchdata
 {
@@ -47,9 +49,13 @@ struct switchdata
   int maxAttacks;		//!< When not 0, maximum number of attacks
   int maxOfRole;		//!< When not 0, maximum number of instances of each unique (non intruder) role
   int oneRolePerAgent;		//!< When 0, agents can perform multiple roles
+  int symmetry;			//!< Prune states that are symmetric to explored ones
+  int stateCache;		//!< When not 0, size in MB of the explored state cache
 
   // Arachne
   int heuristic;		//!< Goal selection method for Arachne engine
+  const struct goalselector *goalSelect;	//!< Named goal selection heuristic, or NULL to use the heuristic mask
+  char *goalWeights;		//!< File with feature weights for the 'weights' goal selection
   int maxIntruderActions;	//!< Maximum number of intruder actions in the semitrace (encrypt/decrypt)
   int agentTypecheck;		//!< Check type of agent variables in all matching modes
   int concrete;			//!< Swap out variables at the end.
@@ -61,6 +67,9 @@ struct switchdata
   int agentUnfold;		//!< Explicitly unfold for N honest agents and 1 compromised iff > 0
   int abstractionMethod;	//!< 0 means none, others are specific modes
   int useAttackBuffer;		//!< Use temporary file for attack storage
+  int jobs;			//!< Number of parallel verification processes
+  int splitDepth;		//!< Maximum proof depth at which alternatives are handed to parallel tasks
+  int portfolio;		//!< Number of heuristics raced per claim
 
   // Misc
   int switchP;			//!< A multi-purpose integer parameter, passed to the partial order reduction method selected.
@@ -70,6 +79,8 @@ struct switchdata
   int addallclaims;		//!< Adds all sorts of claims to the roles
   int check;			//!< Check protocol correctness
   int expert;			//!< Expert mode
+  int server;			//!< Answer verification requests on stdin
+  int hashCons;			//!< Share ground compound terms and compare them by pointer
 
   // Output
   int output;			//!< From enum outputs: what should be produced. Default ATTACK.
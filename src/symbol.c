@@ -31,10 +31,13 @@
    Symbol processor.
 
    Stores symbols for the lexical scanner. Can later print them.
-   Implementation uses a hashtable, the size of which is defined in
-   symbols.h.
+   Implementation uses an open addressing hashtable, which doubles in size
+   when it is half full. Each symbol stores the hash of its text.
 */
 
+//! Initial size of the symbol hash table, a power of two.
+#define SYMBTAB_MINSIZE 1024
+
 /* accessible for externals */
 
 int globalError;		//!< If >0, stdout output goes to stderr (for e.g. terms)
@@ -46,12 +49,18 @@ extern int yylineno;
 
 /* global declarations */
 
-//! Symbol hash table.
-Symbol symbtab[HASHSIZE];
+//! Symbol hash table, with NULL for empty slots.
+Symbol *symbtab;
+//! Number of slots in the symbol hash table.
+int symbsize;
+//! Number of symbols in the symbol hash table.
+int symbcount;
 //! List of available (freed) symbol blocks.
 Symbol symb_list;
 //! List of all allocated symbol blocks.
 Symbol symb_alloc;
+//! Lowest number that may still be free as a symbol without prefix.
+int symb_nextfree;
 
 /* main code */
 
@@ -59,12 +68,12 @@ Symbol symb_alloc;
 void
 symbolsInit (void)
 {
-  int i;
-
-  for (i = 0; i < HASHSIZE; i++)
-    symbtab[i] = NULL;
+  symbtab = NULL;
+  symbsize = 0;
+  symbcount = 0;
   symb_list = NULL;
   symb_alloc = NULL;
+  symb_nextfree = 1;
   globalError = 0;
   globalStream = (char *) stdout;
 }
@@ -81,6 +90,10 @@ symbolsDone (void)
       symb_alloc = s->allocnext;
       free (s);
     }
+  free (symbtab);
+  symbtab = NULL;
+  symbsize = 0;
+  symbcount = 0;
 }
 
 //! Create a memory block for a symbol.
@@ -104,6 +117,7 @@ get_symb (void)
       symb_alloc = t;
     }
   t->keylevel = INT_MAX;
+  t->nextfree = 1;
   return t;
 }
 
@@ -117,57 +131,95 @@ free_symb (const Symbol s)
   symb_list = s;
 }
 
-//! Return the index in the hash table for the string.
-int
+//! Return the hash of a string (FNV-1a).
+unsigned int
 hash (const char *s)
 {
-  int hv = 0;
+  unsigned int hv = 2166136261u;
   int i;
 
   for (i = 0; s[i] != EOS; i++)
     {
-      int v = (hv >> 28) ^ (s[i] & 0xf);
-      hv = (hv << 4) | v;
+      hv = (hv ^ (unsigned char) s[i]) * 16777619u;
     }
-  hv = hv & 0x7fffffff;
-  return hv % HASHSIZE;
+  return hv;
+}
+
+//! Find the slot of a string in the hash table.
+/**
+ *@return The slot with a symbol for the string, or else the empty slot
+ * where it would be inserted.
+ */
+static int
+slotFind (const char *s, const unsigned int hv)
+{
+  int i;
+
+  i = hv & (symbsize - 1);
+  while (symbtab[i] != NULL)
+    {
+      if (symbtab[i]->hash == hv && strcmp (symbtab[i]->text, s) == 0)
+	break;
+      i = (i + 1) & (symbsize - 1);
+    }
+  return i;
+}
+
+//! Double the size of the hash table, or allocate it.
+static void
+symbtabGrow (void)
+{
+  Symbol *old;
+  int oldsize;
+  int i;
+
+  old = symbtab;
+  oldsize = symbsize;
+  symbsize = (oldsize == 0 ? SYMBTAB_MINSIZE : 2 * oldsize);
+  symbtab = (Symbol *) malloc (symbsize * sizeof (Symbol));
+  if (symbtab == NULL)
+    {
+      error ("Out of memory for the symbol table.");
+    }
+  for (i = 0; i < symbsize; i++)
+    symbtab[i] = NULL;
+  for (i = 0; i < oldsize; i++)
+    {
+      if (old[i] != NULL)
+	symbtab[slotFind (old[i]->text, old[i]->hash)] = old[i];
+    }
+  free (old);
 }
 
 //! Insert a string into the hash table.
+/**
+ * A symbol with the same text is replaced.
+ */
 void
 insert (const Symbol s)
 {
-  int hv;
+  int i;
 
   if (s == NULL)
     return;			/* illegal insertion of empty stuff */
 
-  hv = hash (s->text);
-  s->next = symbtab[hv];
-  symbtab[hv] = s;
+  if (2 * (symbcount + 1) > symbsize)
+    symbtabGrow ();
+  s->hash = hash (s->text);
+  i = slotFind (s->text, s->hash);
+  if (symbtab[i] == NULL)
+    symbcount++;
+  symbtab[i] = s;
 }
 
 //! Find a string in the hash table.
 Symbol
 lookup (const char *s)
 {
-  int hv;
-  Symbol t;
-
-  if (s == NULL)
+  if (s == NULL || symbsize == 0)
     return NULL;
 
-  hv = hash (s);
-  t = symbtab[hv];
-
-  while (t != NULL)
-    {
-      if (strcmp (t->text, s) == 0)
-	break;
-      else
-	t = t->next;
-    }
-  return t;
+  return symbtab[slotFind (s, hash (s))];
 }
 
 //! Print a symbol.
@@ -189,21 +241,12 @@ symbolPrintAll (void)
 
   eprintf ("List of all symbols\n");
   count = 0;
-  for (i = 0; i < HASHSIZE; i++)
+  for (i = 0; i < symbsize; i++)
     {
-      Symbol sym;
-
-      sym = symbtab[i];
-      if (sym != NULL)
+      if (symbtab[i] != NULL)
 	{
-	  eprintf ("H%i:\t", i);
-	  while (sym != NULL)
-	    {
-	      count++;
-	      eprintf ("[%s]\t", sym->text);
-	      sym = sym->next;
-	    }
-	  eprintf ("\n");
+	  count++;
+	  eprintf ("H%i:\t[%s]\n", i, symbtab[i]->text);
 	}
     }
   eprintf ("Total:\t%i\n", count);
@@ -231,78 +274,18 @@ symbolSysConst (const char *str)
   return symb;
 }
 
-//! Generate the first fresh free number symbol, prefixed by a certain symbol's string.
+//! Find or create the symbol of a number, prefixed by a certain symbol's string.
 /**
- * Note that there is an upper limit to this, to avoid some problems with buffer overflows etc.
+ * Note that there is an upper limit to the number, to avoid some problems
+ * with buffer overflows etc.
+ *@param mustbenew If non-zero, return NULL if the symbol exists already.
  */
-Symbol
-symbolNextFree (Symbol prefixsymbol)
+static Symbol
+symbolNumbered (const Symbol prefixsymbol, const int n, const int mustbenew)
 {
   char *prefixstr;
-  int n;
   int len;
 
-  if (prefixsymbol != NULL)
-    {
-      prefixstr = (char *) prefixsymbol->text;
-      len = strlen (prefixstr);
-    }
-  else
-    {
-      prefixstr = "";
-      len = 0;
-    }
-
-  n = 1;
-  while (n <= 9999)
-    {
-      /*
-       * The construction below (variable buffer length) is not allowed in ISO C90
-       */
-      char buffer[len + 5];	// thus we must enforce a maximum of 9.999 (allowing for storage of \0 )
-      Symbol symb;
-      int slen;
-
-      slen = sprintf (buffer, "%s%i", prefixstr, n);
-      buffer[slen] = EOS;
-      symb = lookup (buffer);
-      if (symb == NULL)
-	{
-	  char *newstring;
-	  // Copy the buffer to something that will survive
-	  /**
-	   * Memory leak: although this routine should not be called recursively, it will never de-allocate this memory.
-	   * Thus, some precaution is necessary.
-	   * [x][CC]
-	   */
-	  newstring = (char *) malloc (slen + 1);
-	  memcpy (newstring, buffer, slen + 1);
-
-	  /* This persistent string can be used to return a fresh symbol */
-
-	  return symbolSysConst (newstring);
-	}
-
-      // Try next one
-      n++;
-    }
-  error ("We ran out of numbers (%i) when trying to generate a fresh symbol.",
-	 n);
-  return NULL;
-}
-
-//! Return symbol according to integer
-Symbol
-symbolFromInt (int n, Symbol prefixsymbol)
-{
-  char *prefixstr;
-  int len;
-
-  if (!(n <= 9999))
-    {
-      error ("Can only make symbol from int when smaller than 10000");
-    }
-
   if (prefixsymbol != NULL)
     {
       prefixstr = (char *) prefixsymbol->text;
@@ -338,11 +321,67 @@ symbolFromInt (int n, Symbol prefixsymbol)
 
       /* This persistent string can be used to return a fresh symbol */
 
-      symb = symbolSysConst (newstring);
+      symb = get_symb ();
+      symb->lineno = yylineno;
+      symb->type = T_SYSCONST;
+      symb->text = newstring;
+      insert (symb);
+      return symb;
+    }
+  if (mustbenew)
+    {
+      return NULL;
     }
-
   return symb;
+}
+
+//! Generate the first fresh free number symbol, prefixed by a certain symbol's string.
+/**
+ * Symbols are never removed from the table, so a number that was taken
+ * stays taken. The search therefore continues from the number after the
+ * last fresh symbol of the prefix, instead of starting again at 1.
+ *
+ * Note that there is an upper limit to this, to avoid some problems with buffer overflows etc.
+ */
+Symbol
+symbolNextFree (Symbol prefixsymbol)
+{
+  int *counter;
+
+  if (prefixsymbol != NULL)
+    {
+      counter = &prefixsymbol->nextfree;
+    }
+  else
+    {
+      counter = &symb_nextfree;
+    }
+
+  while (*counter <= 9999)
+    {
+      Symbol symb;
 
+      symb = symbolNumbered (prefixsymbol, *counter, 1);
+      (*counter)++;
+      if (symb != NULL)
+	{
+	  return symb;
+	}
+    }
+  error ("We ran out of numbers (%i) when trying to generate a fresh symbol.",
+	 *counter);
+  return NULL;
+}
+
+//! Return symbol according to integer
+Symbol
+symbolFromInt (int n, Symbol prefixsymbol)
+{
+  if (!(n <= 9999))
+    {
+      error ("Can only make symbol from int when smaller than 10000");
+    }
+  return symbolNumbered (prefixsymbol, n, 0);
 }
 
 //! Fix all the unset keylevels
@@ -351,12 +390,12 @@ symbol_fix_keylevels (void)
 {
   int i;
 
-  for (i = 0; i < HASHSIZE; i++)
+  for (i = 0; i < symbsize; i++)
     {
       Symbol sym;
 
       sym = symbtab[i];
-      while (sym != NULL)
+      if (sym != NULL)
 	{
 #ifdef DEBUG
 	  if (DEBUGL (5))
@@ -384,7 +423,6 @@ symbol_fix_keylevels (void)
 		}
 	    }
 #endif
-	  sym = sym->next;
 	}
     }
 }
@@ -22,11 +22,6 @@
 
 #include <stdarg.h>
 
-//! Size of symbol hashtable.
-/** Optimistically large. Should be a prime, says theory.
- */
-#define HASHSIZE 997
-
 enum symboltypes
 { T_UNDEF = -1, T_PROTOCOL, T_CONST, T_VAR, T_SYSCONST };
 
@@ -46,7 +41,11 @@ struct symbol
   int keylevel;
   //! Ascii string with name of the symbol.
   const char *text;
-  //! Possible next pointer.
+  //! Hash of the text, set by insert().
+  unsigned int hash;
+  //! Lowest number that may still be free to append to the text.
+  int nextfree;
+  //! Next pointer in the list of freed symbol blocks.
   struct symbol *next;
   //! Used for linking all symbol blocks, freed or in use.
   struct symbol *allocnext;
@@ -0,0 +1,819 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ *
+ *@file symmetry.c
+ *
+ * Symmetry reduction for the Arachne engine.
+ *
+ * Two semitraces that only differ in the numbering of their runs, or in the
+ * names of interchangeable trusted agents, have isomorphic proof trees. We
+ * therefore compute a canonical form of each state before it is explored,
+ * and prune a state if the state cache (see statecache.c) holds the same
+ * form. Without --symmetry, runs keep their numbers and agents their names,
+ * and the form only identifies equal states.
+ *
+ * The claim run keeps number 0. The other runs are ordered by colors that
+ * do not depend on the numbering: a run starts with the color of its role
+ * and length, and is then refined a few times with the colors of the runs
+ * its terms and bindings refer to. Runs with equal colors keep their
+ * relative order. Agent names are numbered in the order in which they first
+ * occur in the form.
+ *
+ * Equal forms always describe equal semitraces up to renaming, so pruning
+ * is sound. The labelling may fail to identify some equivalent states, which
+ * only costs reduction.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "symmetry.h"
+#include "term.h"
+#include "termlist.h"
+#include "knowledge.h"
+#include "binding.h"
+#include "depend.h"
+#include "switches.h"
+#include "error.h"
+#include "specialterm.h"
+
+extern int proofDepth;
+extern Role I_M;
+
+//! Number of color refinement rounds for the run order
+#define SYMMETRY_ROUNDS		3
+
+//! Tags that mark the parts of a canonical form
+enum symmtags
+{ SF_NULL = 1, SF_LEAF, SF_AGENT, SF_ENCRYPT, SF_TUPLE, SF_RUN, SF_EVENT,
+  SF_BINDING, SF_ORDER
+};
+
+//! An agent name that may be renamed
+struct renamable
+{
+  Term agent;			//!< The agent name
+  int class;			//!< Names of the same class may be interchanged
+};
+
+static struct renamable *renamables = NULL;	//!< Agent names that may be renamed
+static int renamablecount = 0;	//!< Number of renamables
+
+static Term *agentseen = NULL;	//!< Agent names in order of first occurrence
+static int agentcount = 0;	//!< Number of agent names seen in the form
+static int agentmax = 0;	//!< Allocated length of agentseen
+
+static System fsys = NULL;	//!< System of the form being built
+static int runcount = 0;	//!< Number of runs of the form being built
+static int runmax = 0;		//!< Allocated length of the run arrays
+static unsigned int *color = NULL;	//!< Color of each run
+static unsigned int *newcolor = NULL;	//!< Refined color of each run
+static int *order = NULL;	//!< Run at each canonical position
+static int *label = NULL;	//!< Canonical position of each run
+
+static size_t *words = NULL;	//!< Form being built
+static int wordcount = 0;	//!< Number of words in the form
+static int wordmax = 0;		//!< Allocated length of words
+
+static int *bstart = NULL;	//!< Start of each binding in words
+static int *blength = NULL;	//!< Length of each binding in words
+static int *border = NULL;	//!< Bindings in canonical order
+static int bmax = 0;		//!< Allocated length of the binding arrays
+
+//! Mix a word into a hash
+static unsigned int
+mix (const unsigned int h, const size_t v)
+{
+  // Shift in two steps, as size_t may have only 32 bits
+  return (h * 0x9e3779b1u) ^ (unsigned int) v ^ (unsigned int) ((v >> 16) >>
+								  16);
+}
+
+//! Check whether t equals tref with the agents a and b swapped
+static int
+isSwapEqual (Term tref, Term t, const Term a, const Term b)
+{
+  tref = deVar (tref);
+  t = deVar (t);
+  if (tref == NULL || t == NULL)
+    return (tref == t);
+  if (realTermLeaf (tref))
+    {
+      if (isTermEqual (tref, a))
+	return isTermEqual (t, b);
+      if (isTermEqual (tref, b))
+	return isTermEqual (t, a);
+      return isTermEqual (tref, t);
+    }
+  if (tref->type != t->type)
+    return false;
+  if (realTermTuple (tref))
+    return (isSwapEqual (TermOp1 (tref), TermOp1 (t), a, b)
+	    && isSwapEqual (TermOp2 (tref), TermOp2 (t), a, b));
+  return (tref->helper.fcall == t->helper.fcall
+	  && isSwapEqual (TermOp (tref), TermOp (t), a, b)
+	  && isSwapEqual (TermKey (tref), TermKey (t), a, b));
+}
+
+//! Check whether the initial knowledge is invariant under swapping a and b
+static int
+isSwapInvariant (const Termlist kl, const Term a, const Term b)
+{
+  Termlist tl;
+
+  for (tl = kl; tl != NULL; tl = tl->next)
+    {
+      Termlist tl2;
+
+      for (tl2 = kl; tl2 != NULL; tl2 = tl2->next)
+	{
+	  if (isSwapEqual (tl->term, tl2->term, a, b))
+	    break;
+	}
+      if (tl2 == NULL)
+	return false;
+    }
+  return true;
+}
+
+//! Check whether an agent name occurs in a role definition
+static int
+inRoles (const System sys, const Term agent)
+{
+  Protocol p;
+
+  for (p = sys->protocols; p != NULL; p = p->next)
+    {
+      Role r;
+
+      for (r = p->roles; r != NULL; r = r->next)
+	{
+	  Roledef rd;
+
+	  for (rd = r->roledef; rd != NULL; rd = rd->next)
+	    {
+	      if (termSubTerm (rd->from, agent) || termSubTerm (rd->to, agent)
+		  || termSubTerm (rd->message, agent))
+		return true;
+	    }
+	}
+    }
+  return false;
+}
+
+//! Add an agent name to the candidates for renaming
+/**
+ * The name must be trusted and must not occur in the protocol description.
+ * Its class is that of the first candidate it can be swapped with, leaving
+ * the initial intruder knowledge unchanged. Swapping is an equivalence, so
+ * then any permutation within a class leaves it unchanged.
+ */
+static void
+addRenamable (const System sys, const Termlist kl, Term a)
+{
+  int i;
+
+  a = deVar (a);
+  if (!realTermLeaf (a) || realTermVariable (a))
+    return;
+  if (!isAgentTrusted (sys, a) || inRoles (sys, a))
+    return;
+  for (i = 0; i < renamablecount; i++)
+    {
+      if (isTermEqual (renamables[i].agent, a))
+	return;
+    }
+  renamables = (struct renamable *) realloc (renamables,
+					     (renamablecount + 1) *
+					     sizeof (struct renamable));
+  if (renamables == NULL)
+    {
+      error ("Out of memory for the symmetry reduction.");
+    }
+  renamables[renamablecount].agent = a;
+  renamables[renamablecount].class = renamablecount;
+  for (i = 0; i < renamablecount; i++)
+    {
+      if (renamables[i].class == i
+	  && isSwapInvariant (kl, a, renamables[i].agent))
+	{
+	  renamables[renamablecount].class = i;
+	  break;
+	}
+    }
+  renamablecount++;
+}
+
+//! Determine the agent names that may be renamed
+/**
+ * Without --symmetry, no names are renamed. Candidates are the declared agent names and the agent names in the
+ * initial intruder knowledge. A name that cannot be swapped with any other
+ * is not renamed.
+ */
+void
+symmetryInit (const System sys)
+{
+  Termlist kl;
+  Termlist tl;
+  int i, j;
+
+  free (renamables);
+  renamables = NULL;
+  renamablecount = 0;
+  if (!switches.symmetry)
+    {
+      return;
+    }
+  kl = knowledgeSet (sys->know);
+  for (tl = sys->agentnames; tl != NULL; tl = tl->next)
+    {
+      addRenamable (sys, kl, tl->term);
+    }
+  for (tl = kl; tl != NULL; tl = tl->next)
+    {
+      Term t;
+
+      t = deVar (tl->term);
+      if (realTermLeaf (t) && inTermlist (t->stype, TERM_Agent))
+	{
+	  addRenamable (sys, kl, t);
+	}
+    }
+  termlistDelete (kl);
+
+  // Drop the classes of a single name
+  j = 0;
+  for (i = 0; i < renamablecount; i++)
+    {
+      int k;
+
+      for (k = 0; k < renamablecount; k++)
+	{
+	  if (k != i && renamables[k].class == renamables[i].class)
+	    break;
+	}
+      if (k < renamablecount)
+	{
+	  renamables[j] = renamables[i];
+	  j++;
+	}
+    }
+  renamablecount = j;
+}
+
+//! Release the buffers
+void
+symmetryDone (void)
+{
+  free (renamables);
+  renamables = NULL;
+  renamablecount = 0;
+  free (agentseen);
+  agentseen = NULL;
+  agentmax = 0;
+  free (color);
+  free (newcolor);
+  free (order);
+  free (label);
+  color = NULL;
+  newcolor = NULL;
+  order = NULL;
+  label = NULL;
+  runmax = 0;
+  free (words);
+  words = NULL;
+  wordmax = 0;
+  free (bstart);
+  free (blength);
+  free (border);
+  bstart = NULL;
+  blength = NULL;
+  border = NULL;
+  bmax = 0;
+}
+
+//! Class of an agent name that may be renamed, or -1 for other leaves
+static int
+renameClass (const Term t)
+{
+  int i;
+
+  if (realTermVariable (t))
+    return -1;
+  for (i = 0; i < renamablecount; i++)
+    {
+      if (isTermEqual (renamables[i].agent, t))
+	return renamables[i].class;
+    }
+  return -1;
+}
+
+//! Color of a term, seen from a run
+/**
+ * Leaves of other runs contribute the colors of those runs, so the result
+ * does not depend on the run numbering.
+ */
+static unsigned int
+termColor (Term t, const int self)
+{
+  t = deVar (t);
+  if (t == NULL)
+    return SF_NULL;
+  if (realTermLeaf (t))
+    {
+      unsigned int h;
+      int rid;
+
+      if (renameClass (t) >= 0)
+	return mix (SF_AGENT, renameClass (t));
+      h = mix (mix (SF_LEAF, t->type), (size_t) TermSymb (t));
+      rid = TermRunid (t);
+      if (rid == self)
+	return mix (h, 0);
+      if (rid >= 0 && rid < runcount)
+	return mix (mix (h, 1), color[rid]);
+      return mix (mix (h, 2), rid);
+    }
+  if (realTermTuple (t))
+    return mix (mix (SF_TUPLE, termColor (TermOp1 (t), self)),
+		termColor (TermOp2 (t), self));
+  return mix (mix (mix (SF_ENCRYPT, t->helper.fcall),
+		   termColor (TermOp (t), self)), termColor (TermKey (t),
+							     self));
+}
+
+//! Refined color of a run
+static unsigned int
+runColor (const int run)
+{
+  unsigned int h;
+  unsigned int bh;
+  Roledef rd;
+  List bl;
+  int ev;
+  int i;
+
+  h = color[run];
+  for (i = 0; i < fsys->runs[run].rho.length; i++)
+    {
+      h = mix (h, termColor (fsys->runs[run].rho.terms[i], run));
+    }
+  rd = fsys->runs[run].start;
+  for (ev = 0; ev < fsys->runs[run].step; ev++)
+    {
+      h = mix (h, rd->type);
+      h = mix (h, termColor (rd->from, run));
+      h = mix (h, termColor (rd->to, run));
+      if (fsys->runs[run].role != I_M)
+	h = mix (h, termColor (rd->message, run));
+      rd = rd->next;
+    }
+  // The bindings are unordered, so their colors are added
+  bh = 0;
+  for (bl = fsys->bindings; bl != NULL; bl = bl->next)
+    {
+      Binding b;
+
+      b = (Binding) bl->data;
+      if (b->run_to == run)
+	{
+	  unsigned int c;
+
+	  c = mix (mix (mix (SF_BINDING, b->ev_to), b->done),
+		   termColor (b->term, run));
+	  if (b->done && b->run_from >= 0 && b->run_from < runcount)
+	    c = mix (mix (c, color[b->run_from]), b->ev_from);
+	  bh += c;
+	}
+      if (b->done && b->run_from == run && b->run_to >= 0
+	  && b->run_to < runcount)
+	{
+	  bh += mix (mix (mix (SF_ORDER, b->ev_from), color[b->run_to]),
+		     b->ev_to);
+	}
+    }
+  return mix (h, bh);
+}
+
+//! Make sure the run arrays can hold n runs
+static void
+runsReserve (const int n)
+{
+  if (n > runmax)
+    {
+      runmax = n + 8;
+      color = (unsigned int *) realloc (color, runmax * sizeof (unsigned int));
+      newcolor =
+	(unsigned int *) realloc (newcolor, runmax * sizeof (unsigned int));
+      order = (int *) realloc (order, runmax * sizeof (int));
+      label = (int *) realloc (label, runmax * sizeof (int));
+      if (color == NULL || newcolor == NULL || order == NULL || label == NULL)
+	{
+	  error ("Out of memory for the symmetry reduction.");
+	}
+    }
+}
+
+//! Determine the canonical run order
+static void
+canonicalOrder (void)
+{
+  int round;
+  int run;
+  int i;
+
+  if (!switches.symmetry)
+    {
+      // Runs keep their numbers
+      for (run = 0; run < runcount; run++)
+	{
+	  order[run] = run;
+	  label[run] = run;
+	}
+      return;
+    }
+  for (run = 0; run < runcount; run++)
+    {
+      color[run] = mix (mix (mix ((run == 0 ? 1 : 2),
+				  (size_t) fsys->runs[run].protocol),
+			     (size_t) fsys->runs[run].role),
+			fsys->runs[run].step);
+    }
+  for (round = 0; round < SYMMETRY_ROUNDS; round++)
+    {
+      unsigned int *swap;
+
+      for (run = 0; run < runcount; run++)
+	{
+	  newcolor[run] = runColor (run);
+	}
+      swap = color;
+      color = newcolor;
+      newcolor = swap;
+    }
+
+  // Claim run first, then by color; equal colors keep their order
+  for (run = 0; run < runcount; run++)
+    {
+      i = run;
+      while (i > 1 && color[order[i - 1]] > color[run])
+	{
+	  order[i] = order[i - 1];
+	  i--;
+	}
+      order[i] = run;
+    }
+  for (i = 0; i < runcount; i++)
+    {
+      label[order[i]] = i;
+    }
+}
+
+//! Append a word to the form
+static void
+emit (const size_t w)
+{
+  if (wordcount >= wordmax)
+    {
+      wordmax = (wordmax == 0 ? 1024 : 2 * wordmax);
+      words = (size_t *) realloc (words, wordmax * sizeof (size_t));
+      if (words == NULL)
+	{
+	  error ("Out of memory for the symmetry reduction.");
+	}
+    }
+  words[wordcount] = w;
+  wordcount++;
+}
+
+//! Canonical label of a run identifier
+/**
+ * Identifiers that are not runs of the semitrace are kept, shifted out of
+ * the range of the labels.
+ */
+static size_t
+runLabel (const int run)
+{
+  if (run >= 0 && run < runcount)
+    return (size_t) label[run];
+  return (size_t) runcount + (unsigned int) run;
+}
+
+//! Canonical label of an agent name within its class
+static size_t
+agentLabel (const Term t, const int class)
+{
+  int i;
+  int n;
+
+  n = 0;
+  for (i = 0; i < agentcount; i++)
+    {
+      if (isTermEqual (agentseen[i], t))
+	return (size_t) n;
+      if (renameClass (agentseen[i]) == class)
+	n++;
+    }
+  if (agentcount >= agentmax)
+    {
+      agentmax = (agentmax == 0 ? 8 : 2 * agentmax);
+      agentseen = (Term *) realloc (agentseen, agentmax * sizeof (Term));
+      if (agentseen == NULL)
+	{
+	  error ("Out of memory for the symmetry reduction.");
+	}
+    }
+  agentseen[agentcount] = t;
+  agentcount++;
+  return (size_t) n;
+}
+
+//! Append a term to the form
+static void
+emitTerm (Term t)
+{
+  t = deVar (t);
+  if (t == NULL)
+    {
+      emit (SF_NULL);
+      return;
+    }
+  if (realTermLeaf (t))
+    {
+      int class;
+
+      class = renameClass (t);
+      if (class >= 0)
+	{
+	  emit (SF_AGENT);
+	  emit ((size_t) class);
+	  emit (agentLabel (t, class));
+	  return;
+	}
+      emit (SF_LEAF + 16 * t->type);
+      emit ((size_t) TermSymb (t));
+      emit (runLabel (TermRunid (t)));
+      return;
+    }
+  if (realTermTuple (t))
+    {
+      emit (SF_TUPLE);
+      emitTerm (TermOp1 (t));
+      emitTerm (TermOp2 (t));
+      return;
+    }
+  emit (SF_ENCRYPT);
+  emit ((size_t) t->helper.fcall);
+  emitTerm (TermOp (t));
+  emitTerm (TermKey (t));
+}
+
+//! Append a binding to the form
+static void
+emitBinding (const Binding b)
+{
+  emit (SF_BINDING);
+  emit ((size_t) b->done);
+  emit ((size_t) b->blocked);
+  emit ((size_t) b->level);
+  emit (runLabel (b->run_to));
+  emit ((size_t) b->ev_to);
+  if (b->done)
+    {
+      emit (runLabel (b->run_from));
+      emit ((size_t) b->ev_from);
+    }
+  emitTerm (b->term);
+}
+
+//! Compare two bindings in the form, for qsort
+static int
+bindingCompare (const void *p1, const void *p2)
+{
+  int b1, b2;
+  int i;
+
+  b1 = *((const int *) p1);
+  b2 = *((const int *) p2);
+  for (i = 0; i < blength[b1] && i < blength[b2]; i++)
+    {
+      size_t w1, w2;
+
+      w1 = words[bstart[b1] + i];
+      w2 = words[bstart[b2] + i];
+      if (w1 != w2)
+	return (w1 < w2 ? -1 : 1);
+    }
+  if (blength[b1] != blength[b2])
+    return (blength[b1] < blength[b2] ? -1 : 1);
+  return b1 - b2;
+}
+
+//! Append the bindings to the form, in canonical order
+static void
+emitBindings (void)
+{
+  List bl;
+  int n;
+  int first;
+  int sorted;
+  int i;
+
+  n = 0;
+  for (bl = fsys->bindings; bl != NULL; bl = bl->next)
+    n++;
+  if (n > bmax)
+    {
+      bmax = n + 16;
+      bstart = (int *) realloc (bstart, bmax * sizeof (int));
+      blength = (int *) realloc (blength, bmax * sizeof (int));
+      border = (int *) realloc (border, bmax * sizeof (int));
+      if (bstart == NULL || blength == NULL || border == NULL)
+	{
+	  error ("Out of memory for the symmetry reduction.");
+	}
+    }
+
+  // Append them in list order first, then copy them in sorted order
+  first = wordcount;
+  i = 0;
+  for (bl = fsys->bindings; bl != NULL; bl = bl->next)
+    {
+      bstart[i] = wordcount;
+      emitBinding ((Binding) bl->data);
+      blength[i] = wordcount - bstart[i];
+      border[i] = i;
+      i++;
+    }
+  qsort (border, n, sizeof (int), bindingCompare);
+  sorted = wordcount;
+  emit (SF_BINDING);
+  emit ((size_t) n);
+  for (i = 0; i < n; i++)
+    {
+      int j;
+
+      for (j = 0; j < blength[border[i]]; j++)
+	emit (words[bstart[border[i]] + j]);
+    }
+  // Move the sorted copy down over the unsorted one
+  memmove (words + first, words + sorted,
+	   (wordcount - sorted) * sizeof (size_t));
+  wordcount = first + (wordcount - sorted);
+}
+
+//! Append the orderings between events of different runs to the form
+static void
+emitOrders (void)
+{
+  size_t bits;
+  int nbits;
+  int i, j;
+
+  emit (SF_ORDER);
+  bits = 0;
+  nbits = 0;
+  for (i = 0; i < runcount; i++)
+    {
+      int r1, e1;
+
+      r1 = order[i];
+      for (e1 = 0; e1 < fsys->runs[r1].step; e1++)
+	{
+	  for (j = 0; j < runcount; j++)
+	    {
+	      int r2, e2;
+
+	      r2 = order[j];
+	      if (r2 == r1)
+		continue;
+	      for (e2 = 0; e2 < fsys->runs[r2].step; e2++)
+		{
+		  bits = (bits << 1) | (isDependEvent (r1, e1, r2, e2) ? 1 : 0);
+		  nbits++;
+		  if (nbits == (int) (8 * sizeof (size_t)))
+		    {
+		      emit (bits);
+		      bits = 0;
+		      nbits = 0;
+		    }
+		}
+	    }
+	}
+    }
+  emit (bits);
+}
+
+//! Compute the canonical form of the current semitrace
+/**
+ * The form is newly allocated; give it to symmetryAdd() or delete it with
+ * symmetryFormDelete().
+ */
+Symmform
+symmetryForm (const System sys)
+{
+  Symmform f;
+  int run;
+  int i;
+
+  fsys = sys;
+  runcount = sys->maxruns;
+  runsReserve (runcount);
+  canonicalOrder ();
+
+  wordcount = 0;
+  agentcount = 0;
+  emit ((size_t) runcount);
+  if (switches.maxproofdepth < INT_MAX)
+    {
+      // The remaining depth bounds the subtree
+      emit ((size_t) proofDepth);
+    }
+  for (i = 0; i < runcount; i++)
+    {
+      Roledef rd;
+      int ev;
+      int j;
+
+      run = order[i];
+      emit (SF_RUN);
+      emit ((size_t) sys->runs[run].protocol);
+      emit ((size_t) sys->runs[run].role);
+      emit ((size_t) sys->runs[run].step);
+      for (j = 0; j < sys->runs[run].rho.length; j++)
+	{
+	  emitTerm (sys->runs[run].rho.terms[j]);
+	}
+      rd = sys->runs[run].start;
+      for (ev = 0; ev < sys->runs[run].step; ev++)
+	{
+	  emit (SF_EVENT);
+	  emit ((size_t) rd->type);
+	  emit ((size_t) rd->bound);
+	  emitTerm (rd->label);
+	  emitTerm (rd->from);
+	  emitTerm (rd->to);
+	  if (sys->runs[run].role == I_M)
+	    {
+	      // The initial knowledge is the same throughout a claim
+	      emit (SF_NULL);
+	    }
+	  else
+	    {
+	      emitTerm (rd->message);
+	    }
+	  rd = rd->next;
+	}
+    }
+  emitBindings ();
+  emitOrders ();
+
+  f = (Symmform) malloc (sizeof (struct symmform));
+  if (f == NULL)
+    {
+      error ("Out of memory for the symmetry reduction.");
+    }
+  f->length = wordcount;
+  f->words = (size_t *) malloc (wordcount * sizeof (size_t));
+  if (f->words == NULL)
+    {
+      error ("Out of memory for the symmetry reduction.");
+    }
+  memcpy (f->words, words, wordcount * sizeof (size_t));
+  f->hash = 0;
+  for (i = 0; i < wordcount; i++)
+    {
+      f->hash = mix (f->hash, words[i]);
+    }
+  return f;
+}
+
+//! Delete a canonical form
+void
+symmetryFormDelete (Symmform f)
+{
+  if (f != NULL)
+    {
+      free (f->words);
+      free (f);
+    }
+}
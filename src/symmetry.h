@@ -0,0 +1,48 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SYMMETRY
+#define SYMMETRY
+
+#include <stddef.h>
+#include "system.h"
+
+//! Canonical form of a semitrace
+/**
+ * A sequence of words that describes the runs, events, bindings and
+ * orderings of a semitrace, with the run identifiers and the interchangeable
+ * agent names replaced by canonical labels. Semitraces with equal forms
+ * are equal up to such a renaming.
+ */
+struct symmform
+{
+  size_t *words;		//!< The form itself
+  int length;			//!< Number of words
+  unsigned int hash;		//!< Hash of the words
+};
+
+//! Shorthand for canonical form pointer.
+typedef struct symmform *Symmform;
+
+void symmetryInit (const System sys);
+void symmetryDone (void);
+Symmform symmetryForm (const System sys);
+void symmetryFormDelete (Symmform f);
+
+#endif
@@ -26,6 +26,7 @@
 #include <limits.h>
 #include "term.h"
 #include "termlist.h"
+#include "termvec.h"
 #include "knowledge.h"
 #include "system.h"
 #include "debug.h"
@@ -59,6 +60,10 @@ systemInit ()
   sys->step = 0;
   sys->shortestattack = INT_MAX;
   sys->maxtracelength = INT_MAX;
+  sys->traceEvent = NULL;	// allocated by systemStart
+  sys->traceRun = NULL;
+  sys->traceKnow = NULL;
+  sys->traceNode = NULL;
 
   /* init rundefs */
   sys->maxruns = 0;
@@ -88,6 +93,10 @@ systemInit ()
   sys->current_claim = NULL;
   sys->trustedRoles = NULL;
   sys->hasUntypedVariable = false;
+  sys->sends = NULL;
+  sys->sendcount = 0;
+  sys->sendshapes = NULL;
+  sys->sendpositions = NULL;
 
   /* reset global counters */
   systemReset (sys);
@@ -165,6 +174,9 @@ systemDone (const System sys)
   free (sys->traceRun);
   free (sys->traceKnow);
   free (sys->traceNode);
+  free (sys->sends);
+  free (sys->sendshapes);
+  free (sys->sendpositions);
 
   /* clear roledefs */
   while (sys->maxruns > 0)
@@ -195,6 +207,23 @@ systemDestroy (const System sys)
   free (sys);
 }
 
+//! Repair the term vectors of the runs if realloc() moved the run array.
+static void
+runsRelocate (const System sys, const size_t oldaddress, const int count)
+{
+  int i;
+
+  if ((size_t) sys->runs == oldaddress)
+    {
+      return;
+    }
+  for (i = 0; i < count; i++)
+    {
+      termvecRelocate (&(sys->runs[i].rho));
+      termvecRelocate (&(sys->runs[i].sigma));
+    }
+}
+
 //! Ensures that a run can be added to the system.
 /**
  * Allocates memory to allow a run to be added, if needed.
@@ -205,6 +234,7 @@ void
 ensureValidRun (const System sys, int run)
 {
   int i, oldsize;
+  size_t oldaddress;
 
   if (run < sys->maxruns)
     return;
@@ -216,7 +246,9 @@ ensureValidRun (const System sys, int run)
   /* update size parameter */
   oldsize = sys->maxruns;
   sys->maxruns = run + 1;
+  oldaddress = (size_t) sys->runs;
   sys->runs = (Run) realloc (sys->runs, sizeof (struct run) * (sys->maxruns));
+  runsRelocate (sys, oldaddress, oldsize);
 
   /* create runs, set the new pointer(s) to NULL */
   for (i = oldsize; i < sys->maxruns; i++)
@@ -231,8 +263,8 @@ ensureValidRun (const System sys, int run)
       sys->runs[i].start = NULL;
       sys->runs[i].know = NULL;
 
-      sys->runs[i].rho = NULL;
-      sys->runs[i].sigma = NULL;
+      termvecInit (&(sys->runs[i].rho));
+      termvecInit (&(sys->runs[i].sigma));
       sys->runs[i].constants = NULL;
 
       sys->runs[i].locals = NULL;
@@ -314,24 +346,21 @@ not_recv_first (const Roledef rdstart, const Term t)
 Term
 agentOfRunRole (const System sys, const int run, const Term role)
 {
-  Termlist agents;
+  Termvec agents;
+  int i;
 
   // Agent variables have the same symbol as the role names, so
   // we can scan for this.
-  agents = sys->runs[run].rho;
-  while (agents != NULL)
+  agents = &(sys->runs[run].rho);
+  for (i = 0; i < agents->length; i++)
     {
       Term agent;
 
-      agent = agents->term;
+      agent = agents->terms[i];
       if (TermSymb (role) == TermSymb (agent))
 	{
 	  return agent;
 	}
-      else
-	{
-	  agents = agents->next;
-	}
     }
   return NULL;
 }
@@ -422,22 +451,22 @@ run_prefix_recv (const System sys, const int run, Roledef rd,
 
 //! Localize run
 /**
- * Takes a run roledef list and substitutes fromlist into tolist terms.
+ * Takes a run roledef list and substitutes fromvec into tovec terms.
  * Furthermore, localizes all substitutions occurring in this, which termLocal
  * does not. Any localized substitutions are stored as well in a list.
  */
 void
-run_localize (const System sys, const int rid, Termlist fromlist,
-	      Termlist tolist, Termlist substlist)
+run_localize (const System sys, const int rid, const Termvec fromvec,
+	      const Termvec tovec, Termlist substlist)
 {
   Roledef rd;
 
   rd = sys->runs[rid].start;
   while (rd != NULL)
     {
-      rd->from = termLocal (rd->from, fromlist, tolist);
-      rd->to = termLocal (rd->to, fromlist, tolist);
-      rd->message = termLocal (rd->message, fromlist, tolist);
+      rd->from = termLocalVec (rd->from, fromvec, tovec);
+      rd->to = termLocalVec (rd->to, fromvec, tovec);
+      rd->message = termLocalVec (rd->message, fromvec, tovec);
       rd = rd->next;
     }
 
@@ -455,7 +484,7 @@ run_localize (const System sys, const int rid, Termlist fromlist,
       t = substlist->term;
       if (t->subst != NULL)
 	{
-	  t->subst = termLocal (t->subst, fromlist, tolist);
+	  t->subst = termLocalVec (t->subst, fromvec, tovec);
 	  sys->runs[rid].substitutions =
 	    termlistAdd (sys->runs[rid].substitutions, t);
 	}
@@ -479,7 +508,8 @@ roleInstanceArachne (const System sys, const Protocol protocol,
   int rid;
   Run runs;
   Roledef rd;
-  Termlist fromlist = NULL;	// deleted at the end
+  struct termvec fromvec;	// released at the end
+  struct termvec tovec;		// released at the end
   Termlist tolist = NULL;	// -> .locals
   Term extterm = NULL;		// construction thing (will go to artefacts)
 
@@ -502,7 +532,8 @@ roleInstanceArachne (const System sys, const Protocol protocol,
     newt->helper.roleVar = isrole;	// set role status
 
     // Add to copy list
-    TERMLISTADD (fromlist, oldt);
+    termvecAdd (&fromvec, oldt);
+    termvecAdd (&tovec, newt);
     TERMLISTADD (tolist, newt);
 
     // Add to registration lists
@@ -519,7 +550,7 @@ roleInstanceArachne (const System sys, const Protocol protocol,
 	     * We use append to make sure the order is
 	     * consistent with the role names list.
 	     */
-	    TERMLISTAPPEND (runs[rid].rho, newt);
+	    termvecAdd (&(runs[rid].rho), newt);
 	    if (!role->initiator)
 	      {
 		// For non-initiators, we prepend the recving of the role names
@@ -544,7 +575,7 @@ roleInstanceArachne (const System sys, const Protocol protocol,
 	else
 	  {
 	    // normal variable
-	    TERMLISTAPPEND (runs[rid].sigma, newt);
+	    termvecAdd (&(runs[rid].sigma), newt);
 	  }
       }
     else
@@ -584,8 +615,10 @@ roleInstanceArachne (const System sys, const Protocol protocol,
 
   /* Now we need to create local terms corresponding to rho, sigma, and any local constants.
    *
-   * We maintain our stuff in a from/to list.
+   * We maintain our stuff in a from/to vector.
    */
+  termvecInit (&fromvec);
+  termvecInit (&tovec);
 
   // Create rho, sigma, constants
   createLocals (protocol->rolenames, true, true);
@@ -603,9 +636,10 @@ roleInstanceArachne (const System sys, const Protocol protocol,
   runs[rid].know = NULL;
 
   /* now adjust the local run copy */
-  run_localize (sys, rid, fromlist, tolist, substlist);
+  run_localize (sys, rid, &fromvec, &tovec, substlist);
 
-  termlistDelete (fromlist);
+  termvecDone (&fromvec);
+  termvecDone (&tovec);
   runs[rid].locals = tolist;
 
   /* erase any substitutions in the role definition, as they are now copied */
@@ -651,6 +685,7 @@ roleInstanceDestroy (const System sys)
       int runid;
       struct run myrun;
       Termlist substlist;
+      size_t oldaddress;
 
       runid = sys->maxruns - 1;
       myrun = sys->runs[runid];
@@ -663,8 +698,8 @@ roleInstanceDestroy (const System sys)
 
       // Destroy artefacts
       //
-      termlistDelete (myrun.rho);
-      termlistDelete (myrun.sigma);
+      termvecDone (&(sys->runs[runid].rho));
+      termvecDone (&(sys->runs[runid].sigma));
       termlistDelete (myrun.constants);
 
       // sys->variables might contain locals from the run: remove them
@@ -722,7 +757,7 @@ roleInstanceDestroy (const System sys)
 	artefacts = myrun.artefacts;
 	while (artefacts != NULL)
 	  {
-	    free (artefacts->term);
+	    termFree (artefacts->term);
 	    artefacts = artefacts->next;
 	  }
       }
@@ -734,8 +769,10 @@ roleInstanceDestroy (const System sys)
       // Destroy run struct allocation in array using realloc
       // Reduce run count
       sys->maxruns = sys->maxruns - 1;
+      oldaddress = (size_t) sys->runs;
       sys->runs =
 	(Run) realloc (sys->runs, sizeof (struct run) * (sys->maxruns));
+      runsRelocate (sys, oldaddress, sys->maxruns);
     }
 }
 
@@ -917,9 +954,16 @@ isRunTrusted (const System sys, const int run)
 {
   if (run >= 0 && run < sys->maxruns)
     {
-      if (!isAgentlistTrusted (sys, sys->runs[run].rho))
+      Termvec agents;
+      int i;
+
+      agents = &(sys->runs[run].rho);
+      for (i = 0; i < agents->length; i++)
 	{
-	  return 0;
+	  if (!isAgentTrusted (sys, agents->terms[i]))
+	    {
+	      return 0;
+	    }
 	}
     }
   return 1;
@@ -1118,39 +1162,45 @@ int
 iterateLocalToOther (const System sys, const int myrun,
 		     int (*callback) (Term tlocal))
 {
-  Termlist tlo, tls;
+  struct termvec others;
+  Termvec sigma;
   int flag;
+  int i;
 
   int addOther (Term t)
   {
-    tlo = termlistAddNew (tlo, t);
+    if (t != NULL && !inTermvec (&others, t))
+      {
+	termvecAdd (&others, t);
+      }
     return true;
   }
 
   flag = true;
-  tlo = NULL;
+  termvecInit (&others);
   // construct all others occuring in the recvs
-  for (tls = sys->runs[myrun].sigma; tls != NULL; tls = tls->next)
+  sigma = &(sys->runs[myrun].sigma);
+  for (i = 0; i < sigma->length; i++)
     {
       Term tt;
 
-      tt = tls->term;
+      tt = sigma->terms[i];
       if (realTermVariable (tt) && tt->subst != NULL);
       {
 	iterateTermOther (myrun, tt->subst, addOther);
       }
     }
-  // now iterate over all of them
-  for (tls = tlo; flag && (tls != NULL); tls = tls->next)
+  // now iterate over all of them, newest first as before
+  for (i = others.length - 1; flag && i >= 0; i--)
     {
-      if (!callback (tls->term))
+      if (!callback (others.terms[i]))
 	{
 	  flag = false;
 	}
     }
 
   // clean up
-  termlistDelete (tlo);
+  termvecDone (&others);
   return flag;
 }
 
@@ -1288,9 +1338,8 @@ iterateRegularNonHelper (const System sys,
 int
 selfSession (const System sys, const int run)
 {
-  int self_session;
-  Termlist agents;
-  Termlist seen;
+  Termvec agents;
+  int i;
 
   if (sys->runs[run].protocol == INTRUDER)
     {
@@ -1298,30 +1347,21 @@ selfSession (const System sys, const int run)
       return false;
     }
 
-  self_session = false;
-
-  agents = sys->runs[run].rho;
-  seen = NULL;
-  while (agents != NULL)
+  agents = &(sys->runs[run].rho);
+  for (i = 1; i < agents->length; i++)
     {
-      Term agent;
+      int j;
 
-      agent = deVar (agents->term);
-      if (inTermlist (seen, agent))
+      for (j = 0; j < i; j++)
 	{
-	  // This agent was already in the seen list
-	  self_session = true;
-	  break;
-	}
-      else
-	{
-	  seen = termlistAdd (seen, agent);
+	  if (isTermEqual (agents->terms[j], agents->terms[i]))
+	    {
+	      // This agent occurred before in the list
+	      return true;
+	    }
 	}
-      agents = agents->next;
     }
-  termlistDelete (seen);
-
-  return self_session;
+  return false;
 }
 
 //! determine whether a run is a so-called self-responder
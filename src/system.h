@@ -27,6 +27,7 @@
 #include "states.h"
 #include "role.h"
 #include "list.h"
+#include "termvec.h"
 
 #define runPointerGet(sys,run)		sys->runs[run].index
 #define runPointerSet(sys,run,newp)	sys->runs[run].index = newp
@@ -65,8 +66,8 @@ struct run
   Roledef start;		//!< Head of the run definition.
   Knowledge know;		//!< Current knowledge of the run.
 
-  Termlist rho;			//!< As in semantics (copies in artefacts)
-  Termlist sigma;		//!< As in semantics (copies in artefacts)
+  struct termvec rho;		//!< As in semantics (copies in artefacts)
+  struct termvec sigma;		//!< As in semantics (copies in artefacts)
   Termlist constants;		//!< As in semantics (copies in artefacts)
 
   Termlist locals;		//!< Locals of the run (will be deprecated eventually)
@@ -154,6 +155,10 @@ struct system
   Claimlist current_claim;	//!< The claim under current investigation
   Termlist trustedRoles;	//!< Roles that should be trusted for this claim (the default, NULL, means all)
   Termlist proofstate;		//!< State of the proof markers
+  struct sendentry *sends;	//!< Index of the role send events, built by arachneInit()
+  int sendcount;		//!< Number of entries in sends
+  struct sendshape *sendshapes;	//!< Subterm shapes for the send index entries
+  struct subtermpos *sendpositions;	//!< Subterm positions for the send index entries
 };
 
 typedef struct system *System;
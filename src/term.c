@@ -38,11 +38,21 @@
 #include "error.h"
 #include "ctype.h"
 #include "specialterm.h"
+#include "switches.h"
+#include "slab.h"
 
 /* public flag */
 int rolelocal_variable;
 char *RUNSEP;
 
+/* term nodes */
+static struct slab termslab;
+
+/* hash-consing table for ground compound terms (open addressing) */
+static Term *interntable;
+static unsigned int internsize;
+static unsigned int interncount;
+
 /* external definitions */
 
 extern int inTermlist ();	// suppresses a warning, but at what cost?
@@ -62,13 +72,25 @@ termsInit (void)
 {
   rolelocal_variable = 0;
   RUNSEP = "#";
+  slabInit (&termslab, sizeof (struct term));
+  interntable = NULL;
+  internsize = 0;
+  interncount = 0;
   return;
 }
 
 //! Cleanup of terms code.
+/**
+ * Releases all term nodes, including the interned terms.
+ */
 void
 termsDone (void)
 {
+  slabDone (&termslab);
+  free (interntable);
+  interntable = NULL;
+  internsize = 0;
+  interncount = 0;
   return;
 }
 
@@ -79,7 +101,14 @@ termsDone (void)
 Term
 makeTerm ()
 {
-  return (Term) malloc (sizeof (struct term));
+  return (Term) slabAlloc (&termslab);
+}
+
+//! Release the memory of a single term node.
+void
+termFree (Term term)
+{
+  slabFree (&termslab, term);
 }
 
 //! Create a fresh encrypted term from two existing terms.
@@ -96,10 +125,11 @@ makeTermEncrypt (Term t1, Term t2)
   term->type = ENCRYPT;
   term->stype = NULL;
   term->helper.fcall = false;
+  term->interned = false;
   term->subst = NULL;
   TermOp (term) = t1;
   TermKey (term) = t2;
-  return term;
+  return termIntern (term);
 }
 
 Term
@@ -114,11 +144,15 @@ makeTermFcall (Term t1, Term t2)
  *@return A pointer to the new term.
  */
 {
-  Term t;
-
-  t = makeTermEncrypt (t1, t2);
+  Term t = makeTerm ();
+  t->type = ENCRYPT;
+  t->stype = NULL;
   t->helper.fcall = true;
-  return t;
+  t->interned = false;
+  t->subst = NULL;
+  TermOp (t) = t1;
+  TermKey (t) = t2;
+  return termIntern (t);
 }
 
 //! Create a fresh term tuple from two existing terms.
@@ -153,10 +187,11 @@ makeTermTuple (Term t1, Term t2)
   tt->type = TUPLE;
   tt->stype = NULL;
   tt->helper.roleVar = 0;
+  tt->interned = false;
   tt->subst = NULL;
   TermOp1 (tt) = t1;
   TermOp2 (tt) = t2;
-  return tt;
+  return termIntern (tt);
 }
 
 //! Make a term of the given type with run identifier and symbol.
@@ -180,12 +215,150 @@ makeTermType (const int type, const Symbol symb, const int runid)
       // Leaf
       term->helper.roleVar = 0;
     }
+  term->interned = false;
   term->subst = NULL;
   TermSymb (term) = symb;
   TermRunid (term) = runid;
   return term;
 }
 
+//! Determine whether a term can occur below an interned term.
+/**
+ * Interned terms are ground, so their children must be interned terms or
+ * constants. Only constants that live as long as the system qualify: the
+ * constants of a run (run identifier >= 0) are freed with the run, and
+ * role-local constants (run identifier -3) are later treated as variables
+ * by Arachne.
+ */
+static int
+isInternChild (const Term t)
+{
+  if (t == NULL)
+    return false;
+  if (t->interned)
+    return true;
+  return ((t->type == GLOBAL || t->type == LEAF) && TermRunid (t) < 0
+	  && TermRunid (t) != -3);
+}
+
+//! Hash of a child of an interned term.
+/**
+ * Interned children are hashed by address, constants by symbol and run, in
+ * line with isTermEqual().
+ */
+static unsigned int
+internChildHash (const Term t)
+{
+  if (t->interned)
+    return (unsigned int) ((size_t) t >> 4);
+  return ((unsigned int) ((size_t) TermSymb (t) >> 4) * 31u +
+	  (unsigned int) TermRunid (t) * 7u + (unsigned int) t->type);
+}
+
+//! Equality of two children of interned terms.
+static int
+isInternChildEqual (const Term t1, const Term t2)
+{
+  if (t1 == t2)
+    return true;
+  if (t1->interned || t2->interned || t1->type != t2->type)
+    return false;
+  return (TermSymb (t1) == TermSymb (t2) && TermRunid (t1) == TermRunid (t2));
+}
+
+//! Hash of a compound term whose children are intern children.
+static unsigned int
+internHash (const Term t)
+{
+  unsigned int h;
+
+  h = (unsigned int) t->type * 2u + (t->helper.fcall ? 1u : 0u);
+  h = h * 0x9e3779b1u ^ internChildHash (t->left.op);
+  h = h * 0x9e3779b1u ^ internChildHash (t->right.op2);
+  return h ^ (h >> 15);
+}
+
+//! Double the size of the hash-consing table.
+static void
+internGrow (void)
+{
+  Term *oldtable;
+  unsigned int oldsize;
+  unsigned int i;
+
+  oldtable = interntable;
+  oldsize = internsize;
+  internsize = (oldsize == 0 ? 1024 : oldsize * 2);
+  interntable = (Term *) calloc (internsize, sizeof (Term));
+  if (interntable == NULL)
+    {
+      error ("Out of memory for the hash-consing table.");
+    }
+  for (i = 0; i < oldsize; i++)
+    {
+      if (oldtable[i] != NULL)
+	{
+	  unsigned int j;
+
+	  j = internHash (oldtable[i]) & (internsize - 1);
+	  while (interntable[j] != NULL)
+	    j = (j + 1) & (internsize - 1);
+	  interntable[j] = oldtable[i];
+	}
+    }
+  free (oldtable);
+}
+
+//! Share a freshly constructed compound term if it is ground.
+/**
+ * With --hash-cons, every ground encryption, function application or
+ * tuple is kept once: when a structurally equal node was interned
+ * before, the new node is freed and the old one is returned. The
+ * children must already be interned terms or global constants, so
+ * interned terms are built bottom-up. The table also keys on the function
+ * call notation, which isTermEqual() ignores, so two distinct interned
+ * terms may still be equal. Tuples of the form ((x,y),z) are left alone,
+ * because termNormalize() rewrites those in place.
+ *
+ * The argument must be a new node that is not referenced from anywhere
+ * else.
+ *
+ *@return The shared term, or the argument if it cannot be shared.
+ */
+Term
+termIntern (Term t)
+{
+  unsigned int i;
+
+  if (!switches.hashCons || t == NULL || realTermLeaf (t) || t->interned)
+    return t;
+  if (!isInternChild (t->left.op) || !isInternChild (t->right.op2))
+    return t;
+  if (realTermTuple (t) && realTermTuple (TermOp1 (t)))
+    return t;
+
+  if (2 * (interncount + 1) > internsize)
+    internGrow ();
+  i = internHash (t) & (internsize - 1);
+  while (interntable[i] != NULL)
+    {
+      Term it = interntable[i];
+
+      if (it->type == t->type && it->helper.fcall == t->helper.fcall &&
+	  isInternChildEqual (it->left.op, t->left.op) &&
+	  isInternChildEqual (it->right.op2, t->right.op2))
+	{
+	  termFree (t);
+	  return it;
+	}
+      i = (i + 1) & (internsize - 1);
+    }
+  t->interned = true;
+  interntable[i] = t;
+  interncount++;
+  return t;
+}
+
 //! Unwrap any substitutions.
 /**
  * For speed, it is also a macro. Sometimes it will call
@@ -224,6 +397,22 @@ hasTermVariable (Term term)
     }
 }
 
+//! Check whether a term can never change its value
+/**
+ * This holds iff it contains no variables, substituted or not.
+ */
+int
+isTermFixed (const Term t)
+{
+  if (t == NULL)
+    return 1;
+  if (realTermLeaf (t))
+    return (t->type != VARIABLE && TermRunid (t) != -3);
+  if (realTermEncrypt (t))
+    return (isTermFixed (TermOp (t)) && isTermFixed (TermKey (t)));
+  return (isTermFixed (TermOp1 (t)) && isTermFixed (TermOp2 (t)));
+}
+
 //! Safe wrapper for isTermEqual
 
 int
@@ -284,6 +473,37 @@ isTermEqualFn (Term term1, Term term2)
     }
 }
 
+//! Hash a term, consistently with isTermEqual().
+/**
+ * Substituted variables are followed, and function applications hash like
+ * encryptions, so equal terms have equal hashes. As the substitutions
+ * change during the search, hashes of terms with variables should not be
+ * kept.
+ */
+unsigned int
+termHash (Term t)
+{
+  unsigned int h;
+
+  t = deVar (t);
+  if (t == NULL)
+    return 0;
+  if (realTermLeaf (t))
+    {
+      h = (unsigned int) ((size_t) TermSymb (t) >> 4) * 31u +
+	(unsigned int) TermRunid (t);
+    }
+  else
+    {
+      if (realTermEncrypt (t))
+	h = termHash (TermOp (t)) * 0x9e3779b1u ^ termHash (TermKey (t));
+      else
+	h = termHash (TermOp1 (t)) * 0x9e3779b1u ^ termHash (TermOp2 (t));
+      h = h ^ (h >> 15);
+    }
+  return h * 5u + (unsigned int) t->type;
+}
+
 //! See if a term is a subterm of another.
 /**
  *@param t Term to be checked for a subterm.
@@ -483,8 +703,8 @@ termTuplePrint (Term term)
 
 //! Make a deep copy of a term.
 /**
- * Leaves are not copied.
- *@return If the original was a leaf, then the pointer is simply returned. Otherwise, new memory is allocated and the node is copied recursively.
+ * Leaves and interned terms are not copied.
+ *@return If the original was a leaf or an interned term, then the pointer is simply returned. Otherwise, new memory is allocated and the node is copied recursively.
  *\sa termDuplicateDeep()
  */
 
@@ -495,10 +715,10 @@ termDuplicate (const Term term)
 
   if (term == NULL)
     return NULL;
-  if (realTermLeaf (term))
+  if (realTermLeaf (term) || term->interned)
     return term;
 
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   memcpy (newterm, term, sizeof (struct term));
   if (realTermEncrypt (term))
     {
@@ -530,8 +750,9 @@ termNodeDuplicate (const Term term)
   if (realTermLeaf (term))
     return term;
 
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   memcpy (newterm, term, sizeof (struct term));
+  newterm->interned = false;
   return newterm;
 }
 
@@ -551,8 +772,9 @@ termDuplicateDeep (const Term term)
   if (term == NULL)
     return NULL;
 
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   memcpy (newterm, term, sizeof (struct term));
+  newterm->interned = false;
   if (!realTermLeaf (term))
     {
       if (realTermEncrypt (term))
@@ -582,10 +804,10 @@ termDuplicateUV (Term term)
   term = deVar (term);
   if (term == NULL)
     return NULL;
-  if (realTermLeaf (term))
+  if (realTermLeaf (term) || term->interned)
     return term;
 
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   memcpy (newterm, term, sizeof (struct term));
   if (realTermEncrypt (term))
     {
@@ -609,7 +831,7 @@ realTermDuplicate (const Term term)
   if (term == NULL)
     return NULL;
 
-  newterm = (Term) malloc (sizeof (struct term));
+  newterm = makeTerm ();
   if (realTermLeaf (term))
     {
       memcpy (newterm, term, sizeof (struct term));
@@ -617,6 +839,7 @@ realTermDuplicate (const Term term)
   else
     {
       newterm->type = term->type;
+      newterm->interned = false;
       if (realTermEncrypt (term))
 	{
 	  TermOp (newterm) = realTermDuplicate (TermOp (term));
@@ -634,14 +857,14 @@ realTermDuplicate (const Term term)
 //!Removes a term and deallocates memory.
 /**
  * Is meant to remove terms make with termDuplicate. Only deallocates memory
- * of nodes, not of leaves.
+ * of nodes, not of leaves or interned terms.
  *\sa termDuplicate(), termDuplicateUV()
  */
 
 void
 termDelete (const Term term)
 {
-  if (term != NULL && !realTermLeaf (term))
+  if (term != NULL && !realTermLeaf (term) && !term->interned)
     {
       if (realTermEncrypt (term))
 	{
@@ -653,7 +876,7 @@ termDelete (const Term term)
 	  termDelete (TermOp1 (term));
 	  termDelete (TermOp2 (term));
 	}
-      free (term);
+      termFree (term);
     }
 }
 
@@ -669,7 +892,7 @@ void
 termNormalize (Term term)
 {
   term = deVar (term);
-  if (term == NULL || realTermLeaf (term))
+  if (term == NULL || realTermLeaf (term) || term->interned)
     return;
 
   if (realTermEncrypt (term))
@@ -728,12 +951,12 @@ termRunid (Term term, int runid)
       /* anything else, recurse */
       if (realTermEncrypt (term))
 	{
-	  Term t;
-
-	  t = makeTermEncrypt (termRunid (TermOp (term), runid),
-			       termRunid (TermKey (term), runid));
-	  t->helper.fcall = term->helper.fcall;
-	  return t;
+	  if (term->helper.fcall)
+	    return makeTermFcall (termRunid (TermOp (term), runid),
+				  termRunid (TermKey (term), runid));
+	  else
+	    return makeTermEncrypt (termRunid (TermOp (term), runid),
+				    termRunid (TermKey (term), runid));
 	}
       else
 	{
@@ -1554,3 +1777,74 @@ iterateTermOther (const int myrun, Term t, int (*callback) (Term t))
   }
   return term_iterate_deVar (t, testOther, NULL, NULL, NULL);
 }
+
+//! Make a frozen copy of an instantiated term, e.g. as a cache key.
+/**
+ * The copy is made down to the leaves, with all substitutions resolved, so
+ * it does not change when variables are bound later on.
+ */
+Term
+termFreeze (Term t)
+{
+  Term key;
+
+  t = deVar (t);
+  if (t == NULL)
+    return NULL;
+  key = (Term) malloc (sizeof (struct term));
+  memcpy (key, t, sizeof (struct term));
+  key->subst = NULL;
+  key->interned = false;
+  if (realTermTuple (t))
+    {
+      TermOp1 (key) = termFreeze (TermOp1 (t));
+      TermOp2 (key) = termFreeze (TermOp2 (t));
+    }
+  else if (realTermEncrypt (t))
+    {
+      TermOp (key) = termFreeze (TermOp (t));
+      TermKey (key) = termFreeze (TermKey (t));
+    }
+  return key;
+}
+
+//! Release a frozen term copy.
+void
+termFrozenDelete (Term key)
+{
+  if (key == NULL)
+    return;
+  if (realTermTuple (key))
+    {
+      termFrozenDelete (TermOp1 (key));
+      termFrozenDelete (TermOp2 (key));
+    }
+  else if (realTermEncrypt (key))
+    {
+      termFrozenDelete (TermOp (key));
+      termFrozenDelete (TermKey (key));
+    }
+  free (key);
+}
+
+//! Compare a frozen term copy to an instantiated term.
+/**
+ * Only the instantiated term is followed through its substitutions: a variable in
+ * the frozen copy matches only an open occurrence of that variable.
+ */
+int
+isTermFrozenEqual (const Term key, Term t)
+{
+  t = deVar (t);
+  if (key == NULL || t == NULL)
+    return (key == t);
+  if (key->type != t->type)
+    return false;
+  if (realTermLeaf (key))
+    return (TermSymb (key) == TermSymb (t) && TermRunid (key) == TermRunid (t));
+  if (realTermTuple (key))
+    return (isTermFrozenEqual (TermOp1 (key), TermOp1 (t))
+	    && isTermFrozenEqual (TermOp2 (key), TermOp2 (t)));
+  return (isTermFrozenEqual (TermKey (key), TermKey (t))
+	  && isTermFrozenEqual (TermOp (key), TermOp (t)));
+}
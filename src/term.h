@@ -52,6 +52,12 @@ struct term
     int roleVar;		//!< only for leaf, arachne engine: role variable flag
     int fcall;			//!< only for 'encryption' to mark actual function call f(t)
   } helper;
+  //! Hash-consing flag.
+  /**
+   * Non-zero for ground compound terms that are shared through the
+   * hash-consing table: they are never copied, changed, or freed.
+   */
+  int interned;
 
   //! Substitution term.
   /**
@@ -99,10 +105,13 @@ typedef struct term *Term;
 
 void termsInit (void);
 void termsDone (void);
+Term makeTerm ();
+void termFree (Term term);
 Term makeTermEncrypt (Term t1, Term t2);
 Term makeTermFcall (Term t1, Term t2);
 Term makeTermTuple (Term t1, Term t2);
 Term makeTermType (const int type, const Symbol symb, const int runid);
+Term termIntern (Term t);
 __inline__ Term deVarScan (Term t);
 #define realTermLeaf(t)		(t != NULL && t->type <= LEAF)
 #define realTermTuple(t)	(t != NULL && t->type == TUPLE)
@@ -168,7 +177,9 @@ int isTermEqualDebug (Term t1, Term t2);
 #endif
 
 int hasTermVariable (Term term);
+int isTermFixed (const Term t);
 int isTermEqualFn (Term term1, Term term2);
+unsigned int termHash (Term t);
 int termSubTerm (Term t, Term tsub);
 int termInTerm (Term t, Term tsub);
 void termPrintCustom (Term term, char *leftvar, char *rightvar, char *lefttup,
@@ -184,6 +195,9 @@ Term termNodeDuplicate (const Term term);
 Term termDuplicateDeep (const Term term);
 Term termDuplicateUV (Term term);
 void termDelete (const Term term);
+Term termFreeze (Term t);
+void termFrozenDelete (Term key);
+int isTermFrozenEqual (const Term key, Term t);
 void termNormalize (Term term);
 Term termRunid (Term term, int runid);
 int tupleCount (Term tt);
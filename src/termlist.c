@@ -25,6 +25,7 @@
 #include "error.h"
 #include "switches.h"
 #include "knowledge.h"
+#include "slab.h"
 
 /*
  * Shared stuff
@@ -33,6 +34,9 @@
 //! Termlist error thing (for global use)
 Termlist TERMLISTERROR;
 
+//! Termlist nodes
+static struct slab termlistslab;
+
 /*
  * Forward declarations
  */
@@ -43,6 +47,7 @@ Termlist makeTermlist ();
 void
 termlistsInit (void)
 {
+  slabInit (&termlistslab, sizeof (struct termlist));
   TERMLISTERROR = makeTermlist ();
   TERMLISTERROR->term = NULL;
   TERMLISTERROR->prev = NULL;
@@ -55,6 +60,7 @@ void
 termlistsDone (void)
 {
   termlistDelete (TERMLISTERROR);
+  slabDone (&termlistslab);
   return;
 }
 
@@ -66,7 +72,7 @@ Termlist
 makeTermlist ()
 {
   /* inline candidate */
-  return (Termlist) malloc (sizeof (struct termlist));
+  return (Termlist) slabAlloc (&termlistslab);
 }
 
 //! Duplicate a termlist.
@@ -134,7 +140,7 @@ termlistDelete (Termlist tl)
     }
 #endif
   termlistDelete (tl->next);
-  free (tl);
+  slabFree (&termlistslab, tl);
 }
 
 
@@ -150,7 +156,7 @@ termlistDestroy (Termlist tl)
     return;
   termlistDestroy (tl->next);
   termDelete (tl->term);
-  free (tl);
+  slabFree (&termlistslab, tl);
 }
 
 //! Determine whether a term is an element of a termlist.
@@ -366,7 +372,7 @@ termlistDelTerm (Termlist tl)
     }
   if (tl->next != NULL)
     (tl->next)->prev = tl->prev;
-  free (tl);
+  slabFree (&termlistslab, tl);
   return newhead;
 }
 
@@ -661,7 +667,7 @@ termLocal (const Term t, Termlist fromlist, Termlist tolist)
 	  TermOp (newt) = termLocal (TermOp (t), fromlist, tolist);
 	  TermKey (newt) = termLocal (TermKey (t), fromlist, tolist);
 	}
-      return newt;
+      return termIntern (newt);
     }
 }
 
@@ -21,11 +21,27 @@
 #include <stdio.h>
 #include "termmap.h"
 #include "debug.h"
+#include "error.h"
+#include "slab.h"
+
+/*
+ * A function is allocated as one memory block, holding the function, its
+ * buckets and a number of nodes, so that termmapDuplicate() needs a single
+ * allocation. Nodes beyond those come from a slab, and buckets are
+ * allocated separately once the function outgrows them.
+ */
+
+//! Minimal number of buckets of a function
+#define TERMMAP_MINSIZE 8
+
+//! Termmap nodes outside the memory blocks
+static struct slab termmapslab;
 
 //! Open termmaps code.
 void
 termmapsInit (void)
 {
+  slabInit (&termmapslab, sizeof (struct termmapnode));
   return;
 }
 
@@ -33,18 +49,122 @@ termmapsInit (void)
 void
 termmapsDone (void)
 {
+  slabDone (&termmapslab);
   return;
 }
 
-//! Allocate memory for a termmap node.
+//! Allocate an empty function.
 /**
- *@return A pointer to uninitialised memory of the size of a termmap node.
+ *@param size Number of buckets, a power of two.
+ *@param nodes Number of nodes to reserve in the memory block.
+ *@return A pointer to an empty function.
  */
 Termmap
-makeTermmap (void)
+makeTermmap (const int size, const int nodes)
+{
+  Termmap f;
+  int i;
+
+  f = (Termmap) malloc (sizeof (struct termmap) +
+			size * sizeof (Termmapnode) +
+			nodes * sizeof (struct termmapnode));
+  if (f == NULL)
+    {
+      error ("Out of memory for a term map.");
+    }
+  f->first = NULL;
+  f->buckets = (Termmapnode *) (f + 1);
+  f->open = NULL;
+  f->size = size;
+  f->count = 0;
+  f->spare = (Termmapnode) (f->buckets + size);
+  f->sparecount = nodes;
+  f->ownbuckets = 0;
+  for (i = 0; i < size; i++)
+    {
+      f->buckets[i] = NULL;
+    }
+  return f;
+}
+
+//! Find the node of a term.
+/**
+ *@return The node, or NULL when the term is not in the domain.
+ */
+static Termmapnode
+termmapFind (const Termmap f, const Term x)
+{
+  Termmapnode node;
+
+  if (f == NULL)
+    return NULL;
+  if (f->count > 0)
+    {
+      unsigned int h;
+
+      h = termHash (x);
+      for (node = f->buckets[h & (f->size - 1)]; node != NULL;
+	   node = node->chain)
+	{
+	  if (node->hash == h && isTermEqual (x, node->term))
+	    return node;
+	}
+    }
+  for (node = f->open; node != NULL; node = node->chain)
+    {
+      if (isTermEqual (x, node->term))
+	return node;
+    }
+  return NULL;
+}
+
+//! Hash a node into the buckets or the open chain.
+static void
+termmapLink (const Termmap f, const Termmapnode node)
 {
-  /* inline candidate */
-  return (Termmap) malloc (sizeof (struct termmap));
+  if (isTermFixed (node->term))
+    {
+      Termmapnode *bucket;
+
+      node->hash = termHash (node->term);
+      bucket = &f->buckets[node->hash & (f->size - 1)];
+      node->chain = *bucket;
+      *bucket = node;
+    }
+  else
+    {
+      node->chain = f->open;
+      f->open = node;
+    }
+}
+
+//! Double the number of buckets.
+static void
+termmapGrow (const Termmap f)
+{
+  Termmapnode node;
+  int i;
+
+  if (f->ownbuckets)
+    {
+      free (f->buckets);
+    }
+  f->size = 2 * f->size;
+  f->buckets = (Termmapnode *) malloc (f->size * sizeof (Termmapnode));
+  if (f->buckets == NULL)
+    {
+      error ("Out of memory for a term map.");
+    }
+  f->ownbuckets = 1;
+  for (i = 0; i < f->size; i++)
+    {
+      f->buckets[i] = NULL;
+    }
+  f->open = NULL;
+  for (node = f->first; node != NULL; node = node->next)
+    {
+      termmapLink (f, node);
+    }
 }
 
 //! Get function result
@@ -54,12 +174,11 @@ makeTermmap (void)
 int
 termmapGet (Termmap f, const Term x)
 {
-  while (f != NULL)
-    {
-      if (isTermEqual (x, f->term))
-	return f->result;
-      f = f->next;
-    }
+  Termmapnode node;
+
+  node = termmapFind (f, x);
+  if (node != NULL)
+    return node->result;
   return -1;
 }
 
@@ -70,47 +189,87 @@ termmapGet (Termmap f, const Term x)
 Termmap
 termmapSet (const Termmap f, const Term x, const int y)
 {
-  Termmap fscan;
+  Termmap g;
+  Termmapnode node;
 
   //! Determine whether term already occurs
-  fscan = f;
-  while (fscan != NULL)
+  node = termmapFind (f, x);
+  if (node != NULL)
     {
-      if (isTermEqual (x, fscan->term))
-	{
-	  //! Is the result correct already?
-	  if (fscan->result != y)
-	    fscan->result = y;
-	  return f;
-	}
-      fscan = fscan->next;
+      node->result = y;
+      return f;
     }
   //! Not occurred yet, make new node
-  fscan = makeTermmap ();
-  fscan->term = x;
-  fscan->result = y;
-  fscan->next = f;
-  return fscan;
+  g = f;
+  if (g == NULL)
+    {
+      g = makeTermmap (TERMMAP_MINSIZE, TERMMAP_MINSIZE);
+    }
+  if (g->sparecount > 0)
+    {
+      node = g->spare;
+      g->spare++;
+      g->sparecount--;
+      node->inblock = 1;
+    }
+  else
+    {
+      node = (Termmapnode) slabAlloc (&termmapslab);
+      node->inblock = 0;
+    }
+  node->term = x;
+  node->result = y;
+  node->next = g->first;
+  g->first = node;
+  g->count++;
+  if (g->count > g->size)
+    {
+      // Rehashes the new node as well
+      termmapGrow (g);
+    }
+  else
+    {
+      termmapLink (g, node);
+    }
+  return g;
 }
 
 //! Duplicate a function
+/**
+ * The copy, its buckets and its nodes take a single memory block, with
+ * room for a few more nodes.
+ */
 Termmap
 termmapDuplicate (const Termmap f)
 {
-  if (f != NULL)
-    {
-      Termmap g;
+  Termmap g;
+  Termmapnode node;
+  Termmapnode *last;
 
-      g = makeTermmap ();
-      g->term = f->term;
-      g->result = f->result;
-      g->next = termmapDuplicate (f->next);
-      return g;
-    }
-  else
+  if (f == NULL)
     {
       return NULL;
     }
+  g = makeTermmap (f->size, f->count + 2);
+  // Keep the order of the nodes
+  last = &g->first;
+  for (node = f->first; node != NULL; node = node->next)
+    {
+      Termmapnode copy;
+
+      copy = g->spare;
+      g->spare++;
+      g->sparecount--;
+      copy->term = node->term;
+      copy->result = node->result;
+      copy->inblock = 1;
+      copy->next = NULL;
+      *last = copy;
+      last = &copy->next;
+      termmapLink (g, copy);
+    }
+  g->count = f->count;
+  return g;
 }
 
 //! Delete a function
@@ -119,24 +278,54 @@ termmapDelete (const Termmap f)
 {
   if (f != NULL)
     {
-      termmapDelete (f->next);
+      Termmapnode node;
+
+      node = f->first;
+      while (node != NULL)
+	{
+	  Termmapnode next;
+
+	  next = node->next;
+	  if (!node->inblock)
+	    {
+	      slabFree (&termmapslab, node);
+	    }
+	  node = next;
+	}
+      if (f->ownbuckets)
+	{
+	  free (f->buckets);
+	}
       free (f);
     }
 }
 
+//! First node of a function, to iterate over its nodes
+/**
+ *@return The most recently added node, or NULL for the empty function.
+ */
+Termmapnode
+termmapFirst (const Termmap f)
+{
+  if (f == NULL)
+    return NULL;
+  return f->first;
+}
+
 //! Print a function
 void
 termmapPrint (Termmap f)
 {
-  if (f != NULL)
+  Termmapnode node;
+
+  for (node = termmapFirst (f); node != NULL; node = node->next)
     {
       eprintf ("\"");
-      termPrint (f->term);
-      eprintf ("\" -> %i", f->result);
-      if (f->next != NULL)
+      termPrint (node->term);
+      eprintf ("\" -> %i", node->result);
+      if (node->next != NULL)
 	{
 	  eprintf (", ");
-	  termmapPrint (f->next);
 	}
     }
 }
@@ -22,18 +22,52 @@
 
 #include "term.h"
 
+//! A node of a term to integer function.
+struct termmapnode
+{
+  //! The term element for this node.
+  Term term;
+  //! Function result
+  int result;
+  //! termHash() of the term, if it has no variables.
+  unsigned int hash;
+  //! Next node of the function, most recently added first, or NULL.
+  struct termmapnode *next;
+  //! Next node in the same hash bucket, or NULL.
+  struct termmapnode *chain;
+  //! True iff the node is part of the memory block of its function.
+  int inblock;
+};
+
+//! Shorthand for termmap node pointers.
+typedef struct termmapnode *Termmapnode;
+
 //! The function container for the term to integer function type.
 /**
+ * NULL denotes the empty function. Terms without variables are found
+ * through a hash table; terms with variables, whose value may change, are
+ * compared one by one.
+ *
  *\sa term
  */
 struct termmap
 {
-  //! The term element for this node.
-  Term term;
-  //! Next node pointer or NULL for the last element of the function.
-  struct termmap *next;
-  //! Function result
-  int result;
+  //! All nodes, most recently added first.
+  Termmapnode first;
+  //! Hash chains of the nodes whose term has no variables.
+  Termmapnode *buckets;
+  //! Chain of the nodes whose term has variables.
+  Termmapnode open;
+  //! Number of buckets, a power of two.
+  int size;
+  //! Number of nodes.
+  int count;
+  //! Unused nodes in the memory block of the function.
+  Termmapnode spare;
+  //! Number of unused nodes in the memory block.
+  int sparecount;
+  //! True iff the buckets were allocated outside the memory block.
+  int ownbuckets;
 };
 
 //! Shorthand for termmap pointers.
@@ -46,5 +80,6 @@ Termmap termmapSet (const Termmap f, const Term x, const int y);
 Termmap termmapDuplicate (const Termmap f);
 void termmapDelete (const Termmap f);
 void termmapPrint (Termmap f);
+Termmapnode termmapFirst (const Termmap f);
 
 #endif
@@ -0,0 +1,217 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ *@file termvec.c
+ *\brief Small vectors of terms.
+ *
+ * A termvec is a contiguous alternative to a termlist, for the sets of
+ * terms that are built, scanned and thrown away many times during the
+ * search.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "termvec.h"
+#include "error.h"
+
+//! Initialise an empty vector.
+void
+termvecInit (Termvec tv)
+{
+  tv->terms = tv->inlined;
+  tv->length = 0;
+  tv->max = TERMVEC_INLINE;
+}
+
+//! Release the memory of a vector.
+void
+termvecDone (Termvec tv)
+{
+  if (tv->terms != tv->inlined)
+    {
+      free (tv->terms);
+    }
+  termvecInit (tv);
+}
+
+//! Add a term at the end of a vector.
+void
+termvecAdd (Termvec tv, const Term t)
+{
+  if (tv->length == tv->max)
+    {
+      Term *grown;
+
+      grown = (Term *) malloc (2 * tv->max * sizeof (Term));
+      if (grown == NULL)
+	{
+	  error ("Out of memory for a term vector.");
+	}
+      memcpy (grown, tv->terms, tv->length * sizeof (Term));
+      if (tv->terms != tv->inlined)
+	{
+	  free (tv->terms);
+	}
+      tv->terms = grown;
+      tv->max = 2 * tv->max;
+    }
+  tv->terms[tv->length] = t;
+  tv->length++;
+}
+
+//! Add the tuple components of a term to a vector.
+/**
+ * The vector counterpart of tuple_to_termlist().
+ */
+void
+termvecAddComponents (Termvec tv, Term t)
+{
+  t = deVar (t);
+  if (t == NULL)
+    return;
+  if (realTermTuple (t))
+    {
+      termvecAddComponents (tv, TermOp1 (t));
+      termvecAddComponents (tv, TermOp2 (t));
+    }
+  else
+    {
+      termvecAdd (tv, t);
+    }
+}
+
+//! Find a term in a vector.
+/**
+ *@return The index of the last term that equals t, or -1 if there is none.
+ */
+int
+termvecFind (const Termvec tv, const Term t)
+{
+  int i;
+
+  for (i = tv->length - 1; i >= 0; i--)
+    {
+      if (isTermEqual (tv->terms[i], t))
+	return i;
+    }
+  return -1;
+}
+
+//! Check whether a term occurs in a vector.
+int
+inTermvec (const Termvec tv, const Term t)
+{
+  return (termvecFind (tv, t) >= 0);
+}
+
+//! Check whether two vectors contain the same terms, ignoring order.
+/**
+ * The vector counterpart of isTermlistSetEqual().
+ */
+int
+isTermvecSetEqual (const Termvec tv1, const Termvec tv2)
+{
+  int i;
+
+  for (i = 0; i < tv1->length; i++)
+    {
+      if (!inTermvec (tv2, tv1->terms[i]))
+	return false;
+    }
+  for (i = 0; i < tv2->length; i++)
+    {
+      if (!inTermvec (tv1, tv2->terms[i]))
+	return false;
+    }
+  return true;
+}
+
+//! Repair a vector whose structure was moved, e.g. by realloc().
+/**
+ * Only a vector that never outgrew its inlined storage points into its
+ * own structure.
+ */
+void
+termvecRelocate (Termvec tv)
+{
+  if (tv->max == TERMVEC_INLINE)
+    {
+      tv->terms = tv->inlined;
+    }
+}
+
+//! Copy a vector into a new termlist, in the same order.
+/**
+ * For the output code, which works on termlists.
+ */
+Termlist
+termvecToTermlist (const Termvec tv)
+{
+  Termlist tl;
+  int i;
+
+  tl = NULL;
+  for (i = tv->length - 1; i >= 0; i--)
+    {
+      tl = termlistAdd (tl, tv->terms[i]);
+    }
+  return tl;
+}
+
+//! Instantiate a term, mapping the terms of one vector to those of another.
+/**
+ * The vector counterpart of termLocal(). As termlists grow at the front, a
+ * later term of fromvec takes precedence over an earlier equal one.
+ *\sa termLocal()
+ */
+Term
+termLocalVec (const Term t, const Termvec fromvec, const Termvec tovec)
+{
+  if (t == NULL)
+    return NULL;
+
+  if (realTermLeaf (t))
+    {
+      int i;
+
+      i = termvecFind (fromvec, t);
+      if (i >= 0 && i < tovec->length)
+	{
+	  return tovec->terms[i];
+	}
+      return t;
+    }
+  else
+    {
+      Term newt = termNodeDuplicate (t);
+      if (realTermTuple (t))
+	{
+	  TermOp1 (newt) = termLocalVec (TermOp1 (t), fromvec, tovec);
+	  TermOp2 (newt) = termLocalVec (TermOp2 (t), fromvec, tovec);
+	}
+      else
+	{
+	  TermOp (newt) = termLocalVec (TermOp (t), fromvec, tovec);
+	  TermKey (newt) = termLocalVec (TermKey (t), fromvec, tovec);
+	}
+      return termIntern (newt);
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Scyther : An automatic verifier for security protocols.
+ * Copyright (C) 2007-2013 Cas Cremers
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#ifndef TERMVECS
+#define TERMVECS
+
+#include "term.h"
+#include "termlist.h"
+
+//! Number of terms a termvec stores without allocating.
+#define TERMVEC_INLINE 8
+
+//! Growable array of terms, for short-lived sets on hot paths.
+/**
+ * Small vectors keep their terms in the structure itself, so a termvec on
+ * the stack needs no allocation at all. Unlike a termlist, scanning it does
+ * not chase pointers. Initialise with termvecInit() and release with
+ * termvecDone().
+ *\sa termlist
+ */
+struct termvec
+{
+  //! The terms, either inlined or allocated.
+  Term *terms;
+  //! Number of terms.
+  int length;
+  //! Number of terms that fit in terms.
+  int max;
+  //! Storage for small vectors.
+  Term inlined[TERMVEC_INLINE];
+};
+
+//! Shorthand for termvec pointers.
+typedef struct termvec *Termvec;
+
+void termvecInit (Termvec tv);
+void termvecDone (Termvec tv);
+void termvecAdd (Termvec tv, const Term t);
+void termvecAddComponents (Termvec tv, Term t);
+int termvecFind (const Termvec tv, const Term t);
+int inTermvec (const Termvec tv, const Term t);
+int isTermvecSetEqual (const Termvec tv1, const Termvec tv2);
+void termvecRelocate (Termvec tv);
+Termlist termvecToTermlist (const Termvec tv);
+Term termLocalVec (const Term t, const Termvec fromvec, const Termvec tovec);
+
+#endif
@@ -42,6 +42,9 @@ static int time_max_seconds = 0;
 //! Set initial time limit.
 /**
  * <= 0 means none.
+ *
+ * The limit counts from the moment it is set, which for the command-line tool
+ * is at startup, but for an embedded verifier is at the start of each claim.
  */
 void
 set_time_limit (int seconds)
@@ -50,7 +53,12 @@ set_time_limit (int seconds)
     {
       time_max_seconds = seconds;
 #ifdef linux
-      endwait = seconds * sysconf (_SC_CLK_TCK);
+      {
+	struct tms t;
+
+	times (&t);
+	endwait = t.tms_utime + t.tms_stime + seconds * sysconf (_SC_CLK_TCK);
+      }
 #endif
     }
   else
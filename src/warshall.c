@@ -16,24 +16,112 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
-
 // @file warshall.c
 /* Based on public-domain code from Berkeley Yacc */
 
 #include "warshall.h"
 
+/*
+ * Row OR kernels
+ *
+ * The closure ORs whole rows into each other, which vectorizes well. On x86
+ * with a recent enough GCC, SSE2 and AVX2 versions are compiled in, and the
+ * best one the processor supports is picked at the first call; otherwise
+ * (and for rows of a single word) the scalar loop is used.
+ */
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) \
+  && (defined(__i386__) || defined(__x86_64__)) && !defined(FORWINDOWS)
+#define WARSHALL_SIMD
+#include <immintrin.h>
+#endif
+
+static void
+rowOrScalar (bitword * dst, const bitword * src, int words)
+{
+  while (words-- > 0)
+    *dst++ |= *src++;
+}
+
+#ifdef WARSHALL_SIMD
+
+__attribute__ ((target ("sse2")))
+static void
+rowOrSSE2 (bitword * dst, const bitword * src, int words)
+{
+  int i;
+
+  for (i = 0; i + 2 <= words; i += 2)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (dst + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+      _mm_storeu_si128 ((__m128i *) (dst + i), _mm_or_si128 (a, b));
+    }
+  for (; i < words; i++)
+    dst[i] |= src[i];
+}
+
+__attribute__ ((target ("avx2")))
+static void
+rowOrAVX2 (bitword * dst, const bitword * src, int words)
+{
+  int i;
+
+  for (i = 0; i + 4 <= words; i += 4)
+    {
+      __m256i a = _mm256_loadu_si256 ((const __m256i *) (dst + i));
+      __m256i b = _mm256_loadu_si256 ((const __m256i *) (src + i));
+
+      _mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_or_si256 (a, b));
+    }
+  for (; i < words; i++)
+    dst[i] |= src[i];
+}
+
+#endif
+
+//! Selected kernel, NULL until the first call
+static void (*rowOr) (bitword *, const bitword *, int) = NULL;
+
+//! Pick the best row OR kernel for this processor
+static void
+rowOrSelect (void)
+{
+  rowOr = rowOrScalar;
+#ifdef WARSHALL_SIMD
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    rowOr = rowOrAVX2;
+  else if (__builtin_cpu_supports ("sse2"))
+    rowOr = rowOrSSE2;
+#endif
+}
+
+//! OR a row of words into another one: dst |= src
+void
+bitrowOr (bitword * dst, const bitword * src, int words)
+{
+  if (words == 1)
+    {
+      *dst |= *src;
+      return;
+    }
+  if (rowOr == NULL)
+    rowOrSelect ();
+  rowOr (dst, src, words);
+}
+
 void
-transitive_closure (unsigned int *R, int n)
+transitive_closure (bitword * R, int n)
 {
   register int rowsize;
-  register unsigned mask;
-  register unsigned *rowj;
-  register unsigned *rp;
-  register unsigned *rend;
-  register unsigned *ccol;
-  register unsigned *relend;
-  register unsigned *cword;
-  register unsigned *rowi;
+  register bitword mask;
+  register bitword *rowj;
+  register bitword *ccol;
+  register bitword *relend;
+  register bitword *cword;
+  register bitword *rowi;
 
   rowsize = WORDSIZE (n);
   relend = R + n * rowsize;
@@ -49,17 +137,8 @@ transitive_closure (unsigned int *R, int n)
       while (rowj < relend)
 	{
 	  if (*ccol & mask)
-	    {
-	      rp = rowi;
-	      rend = rowj + rowsize;
-	      while (rowj < rend)
-		*rowj++ |= *rp++;
-	    }
-	  else
-	    {
-	      rowj += rowsize;
-	    }
-
+	    bitrowOr (rowj, rowi, rowsize);
+	  rowj += rowsize;
 	  ccol += rowsize;
 	}
 
@@ -75,12 +154,12 @@ transitive_closure (unsigned int *R, int n)
 }
 
 void
-reflexive_transitive_closure (unsigned int *R, int n)
+reflexive_transitive_closure (bitword * R, int n)
 {
   register int rowsize;
-  register unsigned mask;
-  register unsigned *rp;
-  register unsigned *relend;
+  register bitword mask;
+  register bitword *rp;
+  register bitword *relend;
 
   transitive_closure (R, n);
 
@@ -26,6 +26,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "mymalloc.h"
 
@@ -37,7 +38,9 @@
 /*  MAXSHORT is the largest value of a C short                 */
 /*  MINSHORT is the most negative value of a C short           */
 /*  MAXTABLE is the maximum table size                         */
-/*  BITS_PER_WORD is the number of bits in a C unsigned        */
+/*  bitword is the word type of bit matrices (64 bits, so the  */
+/*        closure loops need half the iterations)              */
+/*  BITS_PER_WORD is the number of bits in a bitword           */
 /*  WORDSIZE computes the number of words needed to            */
 /*        store n bits                                         */
 /*  BIT returns the value of the n-th bit starting             */
@@ -49,10 +52,12 @@
 #define MINSHORT        SHRT_MIN
 #define MAXTABLE        32500
 
-#define BITS_PER_WORD        (8*sizeof(unsigned))
+typedef uint64_t bitword;
+
+#define BITS_PER_WORD        (8*sizeof(bitword))
 #define        WORDSIZE(n)        (((n)+(BITS_PER_WORD-1))/BITS_PER_WORD)
 #define        BIT(r, n)        ((((r)[(n)/BITS_PER_WORD])>>((n)%BITS_PER_WORD))&1)
-#define        SETBIT(r, n)        ((r)[(n)/BITS_PER_WORD]|=(1<<((n)%BITS_PER_WORD)))
+#define        SETBIT(r, n)        ((r)[(n)/BITS_PER_WORD]|=((bitword)1<<((n)%BITS_PER_WORD)))
 
 /*  storage allocation macros  */
 
@@ -63,5 +68,6 @@
 
 /* actual functions */
 
-void transitive_closure (unsigned int *R, int n);
-void reflexive_transitive_closure (unsigned int *R, int n);
+void bitrowOr (bitword * dst, const bitword * src, int words);
+void transitive_closure (bitword * R, int n);
+void reflexive_transitive_closure (bitword * R, int n);
@@ -372,18 +372,18 @@ void
 xmlRunVariables (const System sys, const int run)
 {
   int prev_mode;		// buffer for show mode
-  Termlist varlist;
+  Termvec varlist;
+  int i;
 
   prev_mode = show_substitution_path;
   show_substitution_path = true;
   xmlPrint ("<variables>");
   xmlindent++;
 
-  varlist = sys->runs[run].sigma;
-  while (varlist != NULL)
+  varlist = &(sys->runs[run].sigma);
+  for (i = 0; i < varlist->length; i++)
     {
-      xmlVariable (sys, varlist->term, run);
-      varlist = varlist->next;
+      xmlVariable (sys, varlist->terms[i], run);
     }
 
   xmlindent--;